@@ -0,0 +1,207 @@
+#include "batch.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "item_manager.hpp"
+#include "layered_solver.hpp"
+#include "search_context.hpp"
+
+// Parsed lines waiting to be solved. Bounded so a huge input doesn't get buffered whole.
+constexpr std::size_t MAX_PENDING_POSITIONS = 4096;
+
+struct PendingPosition {
+	std::optional<Node> node;
+	std::string error;
+};
+
+static bool parse_count(const std::string &token, int lower_bound, int upper_bound, int &count) {
+	if (token.empty() || token.size() > 2) {
+		return false;
+	}
+	count = 0;
+	for (char c : token) {
+		if (c < '0' || c > '9') {
+			return false;
+		}
+		count = count * 10 + (c - '0');
+	}
+	return count >= lower_bound && count <= upper_bound;
+}
+
+static bool parse_items(const std::string &token, ItemManager &items) {
+	items = ItemManager();
+	if (token == "-") {
+		return true;
+	}
+
+	std::vector<int> counts;
+	std::stringstream stream(token);
+	std::string count_token;
+	while (std::getline(stream, count_token, ',')) {
+		int count;
+		if (!parse_count(count_token, 0, MAX_HELD_ITEM_COUNT, count)) {
+			return false;
+		}
+		counts.push_back(count);
+	}
+	if (counts.empty() || counts.size() > ITEM_KIND_COUNT) {
+		return false;
+	}
+	counts.resize(ITEM_KIND_COUNT, 0);
+
+	items = ItemManager(counts[0], counts[1], counts[2], counts[3], counts[4], counts[5], counts[6],
+	                    counts[7], counts[8]);
+	return items.can_be_held();
+}
+
+std::optional<Node> parse_position(const std::string &line, std::string &error) {
+	std::stringstream stream(line);
+	std::vector<std::string> fields;
+	for (std::string field; stream >> field;) {
+		fields.push_back(field);
+	}
+	if (fields.size() != 9 && fields.size() != 10) {
+		error = "expected 9 or 10 fields, got " + std::to_string(fields.size());
+		return std::nullopt;
+	}
+
+	int max_lives;
+	int dealer_lives;
+	int player_lives;
+	int live_round_count;
+	int blank_round_count;
+	if (!parse_count(fields[0], 2, 6, max_lives) || max_lives % 2 != 0) {
+		error = "max lives must be 2, 4 or 6";
+		return std::nullopt;
+	}
+	if (!parse_count(fields[1], 1, max_lives, dealer_lives) ||
+	    !parse_count(fields[2], 1, max_lives, player_lives)) {
+		error = "lives must be between 1 and max lives";
+		return std::nullopt;
+	}
+	if (!parse_count(fields[3], 0, 8, live_round_count) ||
+	    !parse_count(fields[4], 0, 8, blank_round_count) ||
+	    live_round_count + blank_round_count < 1 || live_round_count + blank_round_count > 8) {
+		error = "there must be between 1 and 8 rounds";
+		return std::nullopt;
+	}
+
+	const bool curr_is_live = fields[5] == "live";
+	const bool curr_is_blank = fields[5] == "blank";
+	if ((!curr_is_live && !curr_is_blank && fields[5] != "-") ||
+	    (curr_is_live && live_round_count == 0) || (curr_is_blank && blank_round_count == 0)) {
+		error = "known round must be '-', 'live' or 'blank' and be loaded";
+		return std::nullopt;
+	}
+
+	ItemManager dealer_items;
+	ItemManager player_items;
+	if (!parse_items(fields[6], dealer_items) || !parse_items(fields[7], player_items)) {
+		error = "items must be '-' or up to 9 comma separated counts, at most 8 in all and 3 of "
+		        "each kind after handcuffs";
+		return std::nullopt;
+	}
+
+	if (fields[8] != "player" && fields[8] != "dealer") {
+		error = "turn must be 'player' or 'dealer'";
+		return std::nullopt;
+	}
+
+	if (fields.size() == 10 && fields[9] != "campaign" && fields[9] != "double_or_nothing") {
+		error = "the optional last field must be 'campaign' or 'double_or_nothing'";
+		return std::nullopt;
+	}
+
+	return Node(fields[8] == "dealer", curr_is_live, curr_is_blank, live_round_count,
+	            blank_round_count, max_lives, dealer_lives, player_lives, dealer_items,
+	            player_items, false, false, true, fields.size() == 10,
+	            fields.size() == 10 && fields[9] == "double_or_nothing");
+}
+
+std::string solve_position(const Node &node, const SearchBudget &budget, bool is_layered,
+                           SearchContext &context) {
+	std::ostringstream result;
+	result.precision(std::numeric_limits<float>::max_digits10);
+	if (is_layered && budget.is_unlimited()) {
+		LayeredSolver solver(node, context);
+		if (node.is_player_turn()) {
+			const std::pair<Action, float> best = solver.get_best_action();
+			result << get_action_name(best.first) << ' ' << best.second;
+		}
+		else {
+			result << "- " << solver.get_ev();
+		}
+	}
+	else if (node.is_player_turn()) {
+		const SearchResult best = node.get_best_action(budget, context);
+		result << get_action_name(best.action) << ' ' << best.ev;
+		if (!budget.is_unlimited()) {
+			result << (best.is_exact ? " exact" : " truncated");
+		}
+	}
+	else {
+		result << "- " << node.get_ev(context);
+		if (!budget.is_unlimited()) {
+			result << (node.is_reload_estimated() ? " truncated" : " exact");
+		}
+	}
+	return result.str();
+}
+
+void run_batch(std::istream &input, std::ostream &output, const SearchBudget &budget,
+               bool is_layered) {
+	std::deque<PendingPosition> pending;
+	std::mutex pending_mutex;
+	std::condition_variable pending_cv;
+	bool is_input_done = false;
+
+	std::thread parser([&] {
+		for (std::string line; std::getline(input, line);) {
+			if (line.empty() || line[0] == '#') {
+				continue;
+			}
+
+			PendingPosition position;
+			position.node = parse_position(line, position.error);
+
+			std::unique_lock<std::mutex> lock(pending_mutex);
+			pending_cv.wait(lock, [&] { return pending.size() < MAX_PENDING_POSITIONS; });
+			pending.push_back(std::move(position));
+			pending_cv.notify_all();
+		}
+
+		std::lock_guard<std::mutex> lock(pending_mutex);
+		is_input_done = true;
+		pending_cv.notify_all();
+	});
+
+	for (;;) {
+		PendingPosition position;
+		{
+			std::unique_lock<std::mutex> lock(pending_mutex);
+			pending_cv.wait(lock, [&] { return !pending.empty() || is_input_done; });
+			if (pending.empty()) {
+				break;
+			}
+			position = std::move(pending.front());
+			pending.pop_front();
+			pending_cv.notify_all();
+		}
+
+		if (position.node) {
+			output << solve_position(*position.node, budget, is_layered) << '\n';
+		}
+		else {
+			output << "error " << position.error << '\n';
+		}
+		output.flush();
+	}
+
+	parser.join();
+}
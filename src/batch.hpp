@@ -0,0 +1,42 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string>
+
+#include "expectimax.hpp"
+
+/*
+ * Positions are given one per line as whitespace separated fields:
+ *   <max lives> <dealer lives> <player lives> <live rounds> <blank rounds> <known round>
+ *   <dealer items> <player items> <turn> [campaign|double_or_nothing]
+ * - known round: "-" (unknown), "live" or "blank"
+ * - items: comma separated counts of magnifying glasses, cigarette packs, beers, handsaws,
+ *   handcuffs, adrenaline, inverters, expired medicine and burner phones, at most 8 in all and at
+ *   most 3 each of the last four. Missing trailing counts are 0, for example "1,0,2" ("-" for no
+ *   items)
+ * - turn: "player" or "dealer"
+ * - campaign: score the position one load further ahead, see Node::is_reload_pending()
+ * - double_or_nothing: the same with the loads of double or nothing, see
+ *   Node::is_double_or_nothing()
+ * Empty lines and lines starting with '#' are skipped.
+ *
+ * Every position produces one line "<action> <ev>", where action is "-" on the dealer's turn, or
+ * "error <message>" if the line could not be parsed. With a search budget (--movetime, --nodes) a
+ * third field "exact" or "truncated" tells whether the EV is exact. It is truncated if the search
+ * did not finish within the budget, and always for double or nothing, whose next load is
+ * estimated. Positions on the dealer's turn are always searched to the end of the load.
+ */
+
+std::optional<Node> parse_position(const std::string &line, std::string &error);
+// Exact solves use the LayeredSolver instead of the recursive search if is_layered is set.
+std::string solve_position(const Node &node, const SearchBudget &budget = SearchBudget{},
+                           bool is_layered = false,
+                           SearchContext &context = get_default_search_context());
+
+// Parses input on a separate thread while solving, and writes every result as soon as it is known.
+void run_batch(std::istream &input, std::ostream &output,
+               const SearchBudget &budget = SearchBudget{}, bool is_layered = false);
+
+#endif  // BATCH_HPP
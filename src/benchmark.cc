@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "batch.hpp"
+#include "expectimax.hpp"
+#include "item_manager.hpp"
+#include "search_context.hpp"
+#include "search_stats.hpp"
+#include "transposition_table.hpp"
+
+struct Args {
+	bool should_output_help = false;
+	int repeat_count = 5;
+	std::size_t hash_size_mb = TRANSPOSITION_TABLE_DEFAULT_SIZE_MB;
+	std::size_t thread_count = 1;
+};
+
+struct BenchmarkPosition {
+	std::string name;
+	Node node;
+};
+
+struct Inventory {
+	const char *name;
+	ItemManager dealer_items;
+	ItemManager player_items;
+};
+
+void print_help(void) {
+	std::cout << "Usage: buckshot-roulette-bench [FLAGS]\n"
+	          << "Solves a fixed corpus of positions from a cold transposition table and prints\n"
+	          << "one JSON object per position, followed by a summary object.\n"
+	          << "  --help, --h        : Print this help message.\n"
+	          << "  --repeat <N>       : Solve every position N times (default 5).\n"
+	          << "  --hash <MB>        : Size of the transposition table in megabytes (default "
+	          << TRANSPOSITION_TABLE_DEFAULT_SIZE_MB << ").\n"
+	          << "  --threads <N>      : Search on N threads (default 1).\n";
+}
+
+Args parse_cmd_args(int argc, char **argv) {
+	Args args;
+	for (int i = 1; i < argc; ++i) {
+		std::string curr = argv[i];
+		if (curr == "--h" || curr == "--help") {
+			args.should_output_help = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			std::cerr << "[WARNING] Ignoring command line argument '" << curr << "'.\n";
+			continue;
+		}
+
+		try {
+			if (curr == "--repeat") {
+				args.repeat_count = std::max(1, std::stoi(argv[++i]));
+			}
+			else if (curr == "--hash") {
+				args.hash_size_mb = std::stoul(argv[++i]);
+			}
+			else if (curr == "--threads") {
+				args.thread_count = std::stoul(argv[++i]);
+			}
+			else {
+				std::cerr << "[WARNING] Ignoring command line argument '" << curr << "'.\n";
+			}
+		}
+		catch (const std::exception &) {
+			std::cerr << "[WARNING] Invalid value '" << argv[i] << "' for " << curr
+			          << ", using default.\n";
+		}
+	}
+	return args;
+}
+
+// Every life tier with the inventory sizes it sees in normal mode (no items in round 1, two per
+// load in round 2 and four per load in round 3, up to a full table of eight), each at every shell
+// count. Changing this list invalidates comparisons with earlier results.
+std::vector<BenchmarkPosition> get_corpus(void) {
+	const std::vector<std::pair<int, std::vector<Inventory>>> tiers = {
+	    {2, {{"empty", ItemManager(), ItemManager()}}},
+	    {4,
+	     {{"empty", ItemManager(), ItemManager()},
+	      {"light", ItemManager(1, 0, 1, 0, 0), ItemManager(0, 1, 0, 1, 0)},
+	      {"medium", ItemManager(1, 1, 1, 1, 0), ItemManager(1, 0, 1, 1, 1)}}},
+	    {6,
+	     {{"medium", ItemManager(1, 1, 1, 1, 0), ItemManager(1, 0, 1, 1, 1)},
+	      {"heavy", ItemManager(1, 1, 2, 1, 1), ItemManager(2, 1, 1, 1, 1)},
+	      {"full", ItemManager(2, 1, 2, 2, 1), ItemManager(2, 2, 1, 2, 1)}}},
+	};
+
+	std::vector<BenchmarkPosition> corpus;
+	for (const auto &[max_lives, inventories] : tiers) {
+		for (const Inventory &inventory : inventories) {
+			for (int shell_count = 1; shell_count <= 8; ++shell_count) {
+				const int live_round_count = (shell_count + 1) / 2;
+				const int blank_round_count = shell_count / 2;
+				corpus.push_back(BenchmarkPosition{
+				    "t" + std::to_string(max_lives) + "_" + std::to_string(live_round_count) + "l" +
+				        std::to_string(blank_round_count) + "b_" + inventory.name,
+				    Node(false, false, false, live_round_count, blank_round_count, max_lives,
+				         max_lives, max_lives, inventory.dealer_items, inventory.player_items)});
+			}
+		}
+	}
+	return corpus;
+}
+
+double get_percentile(const std::vector<double> &sorted_values, double percentile) {
+	const std::size_t rank =
+	    static_cast<std::size_t>(percentile * (sorted_values.size() - 1) + 0.5);
+	return sorted_values[rank];
+}
+
+int main(int argc, char **argv) {
+	Args args = parse_cmd_args(argc, argv);
+
+	if (args.should_output_help) {
+		print_help();
+		return 0;
+	}
+
+	SearchContext context(args.hash_size_mb, args.thread_count);
+
+	uint64_t total_nodes = 0;
+	double total_seconds = 0.0;
+	const std::vector<BenchmarkPosition> corpus = get_corpus();
+
+	for (const BenchmarkPosition &position : corpus) {
+		std::vector<double> latencies_us;
+		SearchStats stats;
+		std::pair<Action, float> result;
+
+		for (int i = 0; i < args.repeat_count; ++i) {
+			context.get_table().clear_table();
+			context.reset_stats();
+
+			const auto start_time = std::chrono::steady_clock::now();
+			result = position.node.get_best_action(context);
+			const auto end_time = std::chrono::steady_clock::now();
+
+			latencies_us.push_back(
+			    std::chrono::duration<double, std::micro>(end_time - start_time).count());
+			stats += context.collect_stats();
+		}
+
+		const double seconds =
+		    std::accumulate(latencies_us.begin(), latencies_us.end(), 0.0) / 1'000'000.0;
+		std::sort(latencies_us.begin(), latencies_us.end());
+		total_nodes += stats.nodes;
+		total_seconds += seconds;
+
+		std::cout << "{\"position\": \"" << position.name << "\", \"action\": \""
+		          << get_action_name(result.first) << "\", \"ev\": " << result.second
+		          << ", \"repeat\": " << args.repeat_count << ", \"wall_ms\": " << seconds * 1000.0
+		          << ", \"nodes\": " << stats.nodes / args.repeat_count
+		          << ", \"nodes_per_sec\": " << (seconds > 0.0 ? stats.nodes / seconds : 0.0)
+		          << ", \"tt_hit_rate\": "
+		          << (stats.tt_probes > 0 ? static_cast<double>(stats.tt_hits) / stats.tt_probes
+		                                  : 0.0)
+		          << ", \"p50_us\": " << get_percentile(latencies_us, 0.5)
+		          << ", \"p90_us\": " << get_percentile(latencies_us, 0.9)
+		          << ", \"p99_us\": " << get_percentile(latencies_us, 0.99)
+		          << ", \"max_us\": " << latencies_us.back() << "}\n";
+	}
+
+	std::cout << "{\"summary\": true, \"positions\": " << corpus.size()
+	          << ", \"threads\": " << args.thread_count
+	          << ", \"wall_ms\": " << total_seconds * 1000.0
+	          << ", \"nodes\": " << total_nodes << ", \"nodes_per_sec\": "
+	          << (total_seconds > 0.0 ? total_nodes / total_seconds : 0.0) << "}\n";
+	return 0;
+}
@@ -0,0 +1,506 @@
+#include "buckshot_roulette.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <optional>
+#include <string>
+#include <system_error>
+
+#include "batch.hpp"
+#include "expectimax.hpp"
+#include "item_manager.hpp"
+#include "layered_solver.hpp"
+#include "search_context.hpp"
+#include "search_stats.hpp"
+#include "tablebase.hpp"
+#include "transposition_table.hpp"
+
+struct buckshot_context {
+	SearchContext context;
+
+	buckshot_context(std::size_t hash_size_mb, std::size_t thread_count)
+	    : context(hash_size_mb, thread_count) {}
+	buckshot_context(const SearchContext &other, std::size_t thread_count)
+	    : context(other.get_shared_table(), other.get_shared_campaign_cache(), thread_count) {}
+};
+
+static_assert(BUCKSHOT_ITEM_KIND_COUNT == ITEM_KIND_COUNT);
+static_assert(BUCKSHOT_ACTION_COUNT == ACTION_COUNT);
+static_assert(BUCKSHOT_USE_BURNER_PHONE == static_cast<int>(Action::USE_BURNER_PHONE));
+static_assert(BUCKSHOT_BURNER_PHONE == static_cast<int>(ItemKind::BURNER_PHONE));
+
+// Positions come from the caller, so a word no function here could have produced is refused.
+static std::optional<Node> to_node(buckshot_position position) {
+	if (!Node::is_valid_key(position.state)) {
+		return std::nullopt;
+	}
+	return Node::from_key(position.state);
+}
+
+static buckshot_position to_position(const Node &node) { return buckshot_position{node.get_key()}; }
+
+static ItemManager make_item_manager(const int *counts) {
+	return ItemManager(counts[0], counts[1], counts[2], counts[3], counts[4], counts[5], counts[6],
+	                   counts[7], counts[8]);
+}
+
+static bool is_valid_item_counts(const int *counts) {
+	return std::all_of(counts, counts + ITEM_KIND_COUNT,
+	                   [](int count) { return count >= 0 && count <= MAX_HELD_ITEM_COUNT; }) &&
+	       make_item_manager(counts).can_be_held();
+}
+
+static void get_item_counts(ItemManager items, int *counts) {
+	counts[0] = items.get_count<ItemKind::MAGNIFYING_GLASS>();
+	counts[1] = items.get_count<ItemKind::CIGARETTE_PACK>();
+	counts[2] = items.get_count<ItemKind::BEER>();
+	counts[3] = items.get_count<ItemKind::HANDSAW>();
+	counts[4] = items.get_count<ItemKind::HANDCUFFS>();
+	counts[5] = items.get_count<ItemKind::ADRENALINE>();
+	counts[6] = items.get_count<ItemKind::INVERTER>();
+	counts[7] = items.get_count<ItemKind::EXPIRED_MEDICINE>();
+	counts[8] = items.get_count<ItemKind::BURNER_PHONE>();
+}
+
+static bool is_round_known(const Node &node) {
+	return node.is_only_live_rounds() || node.round_known_live() || node.is_only_blank_rounds() ||
+	       node.round_known_blank();
+}
+
+// The type the current round is counted as: known to the position, or told by the outcome, which
+// is the type it hit or was shown as.
+static bool is_counted_live(const Node &node, int outcome) {
+	if (node.is_only_live_rounds() || node.round_known_live()) {
+		return true;
+	}
+	if (node.is_only_blank_rounds() || node.round_known_blank()) {
+		return false;
+	}
+	return (outcome != 0) != node.is_round_inverted();
+}
+
+static bool can_be_counted_as(const Node &node, bool is_live) {
+	return is_live ? node.get_live_round_count() > 0 && !node.round_known_blank()
+	               : node.get_blank_round_count() > 0 && !node.round_known_live();
+}
+
+// Whether the side to move holds what action needs. The dealer never uses adrenaline, and after
+// adrenaline the player has to use an item of the dealer before shooting. A cigarette pack that
+// cannot heal is refused instead of wasted, as the search never smokes one.
+static bool is_action_playable(const Node &node, Action action) {
+	const bool is_stealing = node.is_adrenaline_applied();
+	const ItemManager items =
+	    node.is_dealer_turn() != is_stealing ? node.get_dealer_items() : node.get_player_items();
+	switch (action) {
+		case Action::SHOOT_DEALER:
+		case Action::SHOOT_PLAYER:
+			return !is_stealing;
+		case Action::DRINK_BEER:
+			return items.has<ItemKind::BEER>();
+		case Action::SMOKE_CIGARETTE:
+			return items.has<ItemKind::CIGARETTE_PACK>() && node.can_smoke_cigarette();
+		case Action::USE_MAGNIFYING_GLASS:
+			return items.has<ItemKind::MAGNIFYING_GLASS>();
+		case Action::USE_HANDSAW:
+			return items.has<ItemKind::HANDSAW>() && !node.is_handsaw_applied();
+		case Action::USE_HANDCUFFS:
+			return items.has<ItemKind::HANDCUFFS>() && node.is_handcuffs_available() &&
+			       !node.is_handcuffs_applied();
+		case Action::USE_ADRENALINE:
+			return items.has<ItemKind::ADRENALINE>() && node.is_player_turn() && !is_stealing;
+		case Action::USE_INVERTER:
+			return items.has<ItemKind::INVERTER>();
+		case Action::USE_EXPIRED_MEDICINE:
+			return items.has<ItemKind::EXPIRED_MEDICINE>();
+		case Action::USE_BURNER_PHONE:
+			return items.has<ItemKind::BURNER_PHONE>() &&
+			       (node.is_dealer_turn() ||
+			        (node.get_live_round_count() == 1 && node.get_blank_round_count() == 1 &&
+			         !node.round_known_live() && !node.round_known_blank()));
+		default:
+			return false;
+	}
+}
+
+static buckshot_status get_best_action(SearchContext &context, buckshot_position position,
+                                       const buckshot_search_options *options,
+                                       buckshot_result *result) {
+	const std::optional<Node> valid_node = to_node(position);
+	if (!result || !valid_node || valid_node->is_terminal() || valid_node->is_dealer_turn()) {
+		return BUCKSHOT_INVALID_ARGUMENT;
+	}
+	const Node node = valid_node.value();
+	SearchBudget budget;
+	if (options) {
+		budget.time = std::chrono::milliseconds(options->time_ms);
+		budget.nodes = options->nodes;
+	}
+
+	try {
+		SearchResult best;
+		if (options && options->is_layered && budget.is_unlimited()) {
+			const auto [action, ev] = LayeredSolver(node, context).get_best_action();
+			best = SearchResult{action, ev, !node.is_reload_estimated(),
+			                    node.get_live_round_count() + node.get_blank_round_count()};
+		}
+		else {
+			best = node.get_best_action(budget, context);
+		}
+		*result = buckshot_result{static_cast<int>(best.action), best.ev, best.is_exact,
+		                          best.shell_horizon};
+		return BUCKSHOT_OK;
+	}
+	catch (const std::bad_alloc &) {
+		return BUCKSHOT_OUT_OF_MEMORY;
+	}
+}
+
+static buckshot_status get_ev(SearchContext &context, buckshot_position position, float *ev) {
+	const std::optional<Node> node = to_node(position);
+	if (!ev || !node) {
+		return BUCKSHOT_INVALID_ARGUMENT;
+	}
+	try {
+		*ev = node->get_ev(context);
+		return BUCKSHOT_OK;
+	}
+	catch (const std::bad_alloc &) {
+		return BUCKSHOT_OUT_OF_MEMORY;
+	}
+}
+
+static void get_stats(const SearchContext &context, buckshot_stats *stats) {
+	const SearchStats collected = context.collect_stats();
+	stats->nodes = collected.nodes;
+	stats->terminal_evals = collected.terminal_evals;
+	stats->dealer_nodes = collected.dealer_nodes;
+	stats->player_nodes = collected.player_nodes;
+	stats->reload_nodes = collected.reload_nodes;
+	stats->tt_probes = collected.tt_probes;
+	stats->tt_hits = collected.tt_hits;
+	stats->tt_stores = collected.tt_stores;
+	stats->tt_evictions = collected.tt_evictions;
+	stats->max_depth = collected.max_depth;
+	std::copy(std::begin(collected.root_action_ns), std::end(collected.root_action_ns),
+	          stats->root_action_ns);
+}
+
+extern "C" {
+
+int buckshot_api_version(void) { return BUCKSHOT_API_VERSION; }
+
+buckshot_status buckshot_position_make(const buckshot_position_desc *desc,
+                                       buckshot_position *position) {
+	if (!desc || !position) {
+		return BUCKSHOT_INVALID_ARGUMENT;
+	}
+	const int shell_count = desc->live_round_count + desc->blank_round_count;
+	const bool curr_is_live = desc->known_round == BUCKSHOT_ROUND_LIVE;
+	const bool curr_is_blank = desc->known_round == BUCKSHOT_ROUND_BLANK;
+	if ((desc->max_lives != 2 && desc->max_lives != 4 && desc->max_lives != 6) ||
+	    desc->dealer_lives < 1 || desc->dealer_lives > desc->max_lives ||
+	    desc->player_lives < 1 || desc->player_lives > desc->max_lives ||
+	    desc->live_round_count < 0 || desc->blank_round_count < 0 || shell_count < 1 ||
+	    shell_count > 8 || desc->known_round < BUCKSHOT_ROUND_UNKNOWN ||
+	    desc->known_round > BUCKSHOT_ROUND_BLANK ||
+	    (curr_is_live && desc->live_round_count == 0) ||
+	    (curr_is_blank && desc->blank_round_count == 0) ||
+	    !is_valid_item_counts(desc->dealer_items) || !is_valid_item_counts(desc->player_items) ||
+	    desc->mode < BUCKSHOT_MODE_SINGLE_LOAD || desc->mode > BUCKSHOT_MODE_DOUBLE_OR_NOTHING) {
+		return BUCKSHOT_INVALID_ARGUMENT;
+	}
+
+	*position = to_position(
+	    Node(desc->is_dealer_turn != 0, curr_is_live, curr_is_blank, desc->live_round_count,
+	         desc->blank_round_count, desc->max_lives, desc->dealer_lives, desc->player_lives,
+	         make_item_manager(desc->dealer_items), make_item_manager(desc->player_items),
+	         desc->is_handsaw_applied != 0, desc->is_handcuffs_applied != 0, true,
+	         desc->mode != BUCKSHOT_MODE_SINGLE_LOAD,
+	         desc->mode == BUCKSHOT_MODE_DOUBLE_OR_NOTHING));
+	return BUCKSHOT_OK;
+}
+
+buckshot_status buckshot_position_parse(const char *line, buckshot_position *position,
+                                        char *error, size_t error_size) {
+	if (!line || !position) {
+		return BUCKSHOT_INVALID_ARGUMENT;
+	}
+	try {
+		std::string message;
+		const std::optional<Node> node = parse_position(line, message);
+		if (!node) {
+			if (error && error_size > 0) {
+				const std::size_t length = std::min(message.size(), error_size - 1);
+				std::memcpy(error, message.data(), length);
+				error[length] = '\0';
+			}
+			return BUCKSHOT_INVALID_ARGUMENT;
+		}
+		*position = to_position(*node);
+		return BUCKSHOT_OK;
+	}
+	catch (const std::bad_alloc &) {
+		return BUCKSHOT_OUT_OF_MEMORY;
+	}
+}
+
+void buckshot_position_describe(buckshot_position position, buckshot_position_desc *desc) {
+	const std::optional<Node> valid_node = to_node(position);
+	if (!valid_node) {
+		*desc = buckshot_position_desc{};
+		return;
+	}
+	const Node node = valid_node.value();
+	desc->max_lives = node.get_max_lives();
+	desc->dealer_lives = node.get_dealer_lives();
+	desc->player_lives = node.get_player_lives();
+	desc->live_round_count = node.get_live_round_count();
+	desc->blank_round_count = node.get_blank_round_count();
+	desc->known_round = node.round_known_live()    ? BUCKSHOT_ROUND_LIVE
+	                    : node.round_known_blank() ? BUCKSHOT_ROUND_BLANK
+	                                               : BUCKSHOT_ROUND_UNKNOWN;
+	get_item_counts(node.get_dealer_items(), desc->dealer_items);
+	get_item_counts(node.get_player_items(), desc->player_items);
+	desc->is_dealer_turn = node.is_dealer_turn();
+	desc->is_handsaw_applied = node.is_handsaw_applied();
+	desc->is_handcuffs_applied = node.is_handcuffs_applied();
+	desc->mode = !node.is_reload_pending()     ? BUCKSHOT_MODE_SINGLE_LOAD
+	             : node.is_double_or_nothing() ? BUCKSHOT_MODE_DOUBLE_OR_NOTHING
+	                                           : BUCKSHOT_MODE_CAMPAIGN;
+}
+
+int buckshot_position_is_terminal(buckshot_position position) {
+	const std::optional<Node> node = to_node(position);
+	return !node || node->is_terminal();
+}
+
+int buckshot_action_needs_outcome(buckshot_position position, buckshot_action action) {
+	const std::optional<Node> valid_node = to_node(position);
+	if (!valid_node) {
+		return 0;
+	}
+	const Node node = valid_node.value();
+	switch (static_cast<Action>(action)) {
+		case Action::SHOOT_DEALER:
+		case Action::SHOOT_PLAYER:
+		case Action::DRINK_BEER:
+			return !is_round_known(node);
+		case Action::USE_MAGNIFYING_GLASS:
+		case Action::USE_BURNER_PHONE:
+			return node.is_player_turn() && !is_round_known(node);
+		case Action::USE_EXPIRED_MEDICINE:
+			return true;
+		default:
+			return false;
+	}
+}
+
+buckshot_status buckshot_position_apply(buckshot_position *position, buckshot_action action,
+                                        int outcome) {
+	if (!position || action < 0 || action >= BUCKSHOT_ACTION_COUNT) {
+		return BUCKSHOT_INVALID_ARGUMENT;
+	}
+	const std::optional<Node> valid_node = to_node(*position);
+	const Action node_action = static_cast<Action>(action);
+	if (!valid_node || valid_node->is_terminal() ||
+	    !is_action_playable(valid_node.value(), node_action)) {
+		return BUCKSHOT_INVALID_ARGUMENT;
+	}
+	Node node = valid_node.value();
+
+	// The phone shows the other round, the current one is of the other type.
+	const bool is_live = node_action == Action::USE_BURNER_PHONE
+	                         ? is_counted_live(node, outcome == 0)
+	                         : is_counted_live(node, outcome);
+	switch (node_action) {
+		case Action::SHOOT_DEALER:
+		case Action::SHOOT_PLAYER:
+		case Action::DRINK_BEER:
+			if (!can_be_counted_as(node, is_live)) {
+				return BUCKSHOT_INVALID_ARGUMENT;
+			}
+			break;
+		case Action::USE_MAGNIFYING_GLASS:
+		case Action::USE_BURNER_PHONE:
+			if (node.is_player_turn() && !can_be_counted_as(node, is_live)) {
+				return BUCKSHOT_INVALID_ARGUMENT;
+			}
+			break;
+		default:
+			break;
+	}
+
+	switch (node_action) {
+		case Action::SHOOT_DEALER:
+			is_live ? node.apply_shoot_dealer_live() : node.apply_shoot_dealer_blank();
+			break;
+		case Action::SHOOT_PLAYER:
+			is_live ? node.apply_shoot_player_live() : node.apply_shoot_player_blank();
+			break;
+		case Action::DRINK_BEER:
+			is_live ? node.apply_drink_beer_live() : node.apply_drink_beer_blank();
+			break;
+		case Action::SMOKE_CIGARETTE:
+			node.apply_smoke_cigarette();
+			break;
+		case Action::USE_MAGNIFYING_GLASS:
+			if (node.is_dealer_turn()) {
+				node.dealer_remove_magnifying_glass();
+			}
+			else {
+				is_live ? node.apply_magnify_live() : node.apply_magnify_blank();
+			}
+			break;
+		case Action::USE_HANDSAW:
+			node.apply_use_handsaw();
+			break;
+		case Action::USE_HANDCUFFS:
+			node.apply_use_handcuffs();
+			break;
+		case Action::USE_ADRENALINE:
+			node.apply_use_adrenaline();
+			break;
+		case Action::USE_INVERTER:
+			node.apply_use_inverter();
+			break;
+		case Action::USE_EXPIRED_MEDICINE:
+			outcome != 0 ? node.apply_expired_medicine_heal()
+			             : node.apply_expired_medicine_damage();
+			break;
+		case Action::USE_BURNER_PHONE:
+			if (node.is_dealer_turn()) {
+				node.dealer_remove_burner_phone();
+			}
+			else {
+				is_live ? node.apply_burner_phone_live() : node.apply_burner_phone_blank();
+			}
+			break;
+	}
+	*position = to_position(node);
+	return BUCKSHOT_OK;
+}
+
+buckshot_status buckshot_get_best_action(buckshot_position position,
+                                         const buckshot_search_options *options,
+                                         buckshot_result *result) {
+	return get_best_action(get_default_search_context(), position, options, result);
+}
+
+buckshot_status buckshot_get_ev(buckshot_position position, float *ev) {
+	return get_ev(get_default_search_context(), position, ev);
+}
+
+const char *buckshot_action_name(int action) {
+	return action >= 0 && action < ACTION_COUNT ? ACTION_NAMES[action] : nullptr;
+}
+
+buckshot_status buckshot_set_hash_size_mb(size_t size_mb) {
+	try {
+		get_default_search_context().resize_caches(size_mb);
+		return BUCKSHOT_OK;
+	}
+	catch (const std::bad_alloc &) {
+		return BUCKSHOT_OUT_OF_MEMORY;
+	}
+}
+
+size_t buckshot_get_hash_size_mb(void) {
+	return get_default_search_context().get_table().get_size_mb();
+}
+
+void buckshot_clear_hash(void) {
+	get_default_search_context().get_table().clear_table();
+	get_default_search_context().get_campaign_cache().clear();
+}
+
+buckshot_status buckshot_set_thread_count(size_t thread_count) {
+	try {
+		get_default_search_context().set_thread_count(thread_count);
+		return BUCKSHOT_OK;
+	}
+	catch (const std::bad_alloc &) {
+		return BUCKSHOT_OUT_OF_MEMORY;
+	}
+	catch (const std::system_error &) {
+		return BUCKSHOT_OUT_OF_MEMORY;
+	}
+}
+
+void buckshot_set_parallel_cutoff(int subtree_depth) {
+	get_default_search_context().set_parallel_cutoff(subtree_depth);
+}
+
+buckshot_status buckshot_open_tablebase(const char *path) {
+	if (!path) {
+		return BUCKSHOT_INVALID_ARGUMENT;
+	}
+	return tablebase.open(path) ? BUCKSHOT_OK : BUCKSHOT_IO_ERROR;
+}
+
+int buckshot_stats_enabled(void) { return SEARCH_STATS_ENABLED; }
+
+void buckshot_reset_stats(void) { get_default_search_context().reset_stats(); }
+
+void buckshot_get_stats(buckshot_stats *stats) { get_stats(get_default_search_context(), stats); }
+
+buckshot_context *buckshot_context_create(size_t hash_size_mb, size_t thread_count) {
+	try {
+		return new buckshot_context(hash_size_mb, thread_count);
+	}
+	catch (const std::bad_alloc &) {
+		return nullptr;
+	}
+	catch (const std::system_error &) {
+		return nullptr;
+	}
+}
+
+buckshot_context *buckshot_context_create_shared(const buckshot_context *other,
+                                                 size_t thread_count) {
+	if (!other) {
+		return nullptr;
+	}
+	try {
+		return new buckshot_context(other->context, thread_count);
+	}
+	catch (const std::bad_alloc &) {
+		return nullptr;
+	}
+	catch (const std::system_error &) {
+		return nullptr;
+	}
+}
+
+void buckshot_context_destroy(buckshot_context *context) { delete context; }
+
+buckshot_status buckshot_context_get_best_action(buckshot_context *context,
+                                                 buckshot_position position,
+                                                 const buckshot_search_options *options,
+                                                 buckshot_result *result) {
+	if (!context) {
+		return BUCKSHOT_INVALID_ARGUMENT;
+	}
+	return get_best_action(context->context, position, options, result);
+}
+
+buckshot_status buckshot_context_get_ev(buckshot_context *context, buckshot_position position,
+                                        float *ev) {
+	if (!context) {
+		return BUCKSHOT_INVALID_ARGUMENT;
+	}
+	return get_ev(context->context, position, ev);
+}
+
+void buckshot_context_clear_hash(buckshot_context *context) {
+	context->context.get_table().clear_table();
+	context->context.get_campaign_cache().clear();
+}
+
+void buckshot_context_reset_stats(buckshot_context *context) { context->context.reset_stats(); }
+
+void buckshot_context_get_stats(buckshot_context *context, buckshot_stats *stats) {
+	get_stats(context->context, stats);
+}
+
+}  // extern "C"
@@ -0,0 +1,202 @@
+#ifndef BUCKSHOT_ROULETTE_H
+#define BUCKSHOT_ROULETTE_H
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * C interface of the solver library, for embedding it in-process. Nothing here throws or exits,
+ * every failure is a buckshot_status.
+ *
+ * The ABI is stable: enum values, struct layouts and function signatures are never changed or
+ * removed. New functions, enum values and structs are added with a new BUCKSHOT_API_VERSION.
+ *
+ * Searches run on a context, which holds the transposition table, the threads they are split
+ * across and the search counters. The functions without a context argument use a default context
+ * of the process. Any number of searches may run at once from different threads, on the same
+ * context or on different ones. Resize a table or change the thread count of a context only while
+ * it is not searching.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BUCKSHOT_API_VERSION 2
+#define BUCKSHOT_ITEM_KIND_COUNT 9
+#define BUCKSHOT_ACTION_COUNT 11
+
+typedef enum buckshot_status {
+	BUCKSHOT_OK = 0,
+	BUCKSHOT_INVALID_ARGUMENT = 1,  // nothing was changed
+	BUCKSHOT_OUT_OF_MEMORY = 2,
+	BUCKSHOT_IO_ERROR = 3,
+} buckshot_status;
+
+typedef enum buckshot_action {
+	BUCKSHOT_SHOOT_DEALER = 0,
+	BUCKSHOT_SHOOT_PLAYER = 1,
+	BUCKSHOT_DRINK_BEER = 2,
+	BUCKSHOT_SMOKE_CIGARETTE = 3,
+	BUCKSHOT_USE_MAGNIFYING_GLASS = 4,
+	BUCKSHOT_USE_HANDSAW = 5,
+	BUCKSHOT_USE_HANDCUFFS = 6,
+	BUCKSHOT_USE_ADRENALINE = 7,
+	BUCKSHOT_USE_INVERTER = 8,
+	BUCKSHOT_USE_EXPIRED_MEDICINE = 9,
+	BUCKSHOT_USE_BURNER_PHONE = 10,
+} buckshot_action;
+
+// Indices of the item count arrays.
+typedef enum buckshot_item_kind {
+	BUCKSHOT_MAGNIFYING_GLASS = 0,
+	BUCKSHOT_CIGARETTE_PACK = 1,
+	BUCKSHOT_BEER = 2,
+	BUCKSHOT_HANDSAW = 3,
+	BUCKSHOT_HANDCUFFS = 4,
+	BUCKSHOT_ADRENALINE = 5,
+	BUCKSHOT_INVERTER = 6,
+	BUCKSHOT_EXPIRED_MEDICINE = 7,
+	BUCKSHOT_BURNER_PHONE = 8,
+} buckshot_item_kind;
+
+typedef enum buckshot_known_round {
+	BUCKSHOT_ROUND_UNKNOWN = 0,
+	BUCKSHOT_ROUND_LIVE = 1,
+	BUCKSHOT_ROUND_BLANK = 2,
+} buckshot_known_round;
+
+typedef enum buckshot_mode {
+	BUCKSHOT_MODE_SINGLE_LOAD = 0,  // the game is scored when the shotgun is empty
+	BUCKSHOT_MODE_CAMPAIGN = 1,     // the search looks one load ahead
+	BUCKSHOT_MODE_DOUBLE_OR_NOTHING = 2,
+} buckshot_mode;
+
+// A position, copied by value. The meaning of its bits is internal and may change between builds,
+// so keep positions only while the library is loaded.
+typedef struct buckshot_position {
+	uint64_t state;
+} buckshot_position;
+
+// The fields of a position as seen at the table.
+typedef struct buckshot_position_desc {
+	int max_lives;  // 2, 4 or 6
+	int dealer_lives;
+	int player_lives;
+	int live_round_count;  // 1 to 8 rounds in total
+	int blank_round_count;
+	int known_round;  // buckshot_known_round
+	// Counts by buckshot_item_kind, at most 8 per side and at most 3 of each kind after handcuffs.
+	int dealer_items[BUCKSHOT_ITEM_KIND_COUNT];
+	int player_items[BUCKSHOT_ITEM_KIND_COUNT];
+	int is_dealer_turn;
+	int is_handsaw_applied;
+	int is_handcuffs_applied;
+	int mode;  // buckshot_mode
+} buckshot_position_desc;
+
+// Zero limits mean no limit, an unlimited search is exact.
+typedef struct buckshot_search_options {
+	uint64_t time_ms;
+	uint64_t nodes;
+	int is_layered;  // solve exact searches with the layered solver instead of the recursive one
+} buckshot_search_options;
+
+typedef struct buckshot_result {
+	int action;  // buckshot_action
+	float ev;
+	int is_exact;
+	int shell_horizon;  // shells searched before estimating, all of them if exact
+} buckshot_result;
+
+// Summed over all searches of a context since its stats were last reset, zero unless the library
+// was built with BUCKSHOT_SEARCH_STATS. See src/search_stats.hpp for the meaning of each.
+typedef struct buckshot_stats {
+	uint64_t nodes;
+	uint64_t terminal_evals;
+	uint64_t dealer_nodes;
+	uint64_t player_nodes;
+	uint64_t reload_nodes;
+	uint64_t tt_probes;
+	uint64_t tt_hits;
+	uint64_t tt_stores;
+	uint64_t tt_evictions;
+	uint64_t max_depth;
+	uint64_t root_action_ns[BUCKSHOT_ACTION_COUNT];
+} buckshot_stats;
+
+// Searches, caches and counters of their own, see above.
+typedef struct buckshot_context buckshot_context;
+
+int buckshot_api_version(void);
+
+buckshot_status buckshot_position_make(const buckshot_position_desc *desc,
+                                       buckshot_position *position);
+// Parses a line of the batch format (see src/batch.hpp). The reason for a failure is written to
+// error if it is not NULL, cut to error_size bytes including the terminating zero.
+buckshot_status buckshot_position_parse(const char *line, buckshot_position *position,
+                                        char *error, size_t error_size);
+// Positions are only those returned by the functions here. Any other word is refused with
+// BUCKSHOT_INVALID_ARGUMENT, described as all zeros and counts as terminal.
+void buckshot_position_describe(buckshot_position position, buckshot_position_desc *desc);
+int buckshot_position_is_terminal(buckshot_position position);
+
+// Whether applying action takes an outcome the position does not know: the type a shot or an
+// ejected round turned out as, what the player's magnifying glass or burner phone showed, or
+// whether expired medicine healed.
+int buckshot_action_needs_outcome(buckshot_position position, buckshot_action action);
+// Plays action for the side to move. outcome is non-zero if the round hit or was shown as live
+// (for the burner phone: the last round), or the medicine healed, and ignored if the action does
+// not need one. The player's burner phone is only modeled with one live and one blank round left,
+// and a cigarette pack only while it heals: below full health and not on the fade charge.
+buckshot_status buckshot_position_apply(buckshot_position *position, buckshot_action action,
+                                        int outcome);
+
+// The player's best action and its EV. options may be NULL for an exact search.
+buckshot_status buckshot_get_best_action(buckshot_position position,
+                                         const buckshot_search_options *options,
+                                         buckshot_result *result);
+// EV of a position with either side to move, searched to the end. Exact except for double or
+// nothing, whose next load is estimated.
+buckshot_status buckshot_get_ev(buckshot_position position, float *ev);
+// Name of an action as in the batch format, for example "shoot_dealer". NULL if out of range.
+const char *buckshot_action_name(int action);
+
+// The transposition table keeps its contents across searches until it is resized or cleared.
+// Clearing also drops the cached campaign EVs, which take at most about as much memory as the
+// table.
+buckshot_status buckshot_set_hash_size_mb(size_t size_mb);
+size_t buckshot_get_hash_size_mb(void);
+void buckshot_clear_hash(void);
+// Number of threads searches run on (1 searches on the caller only), and the fewest shells and
+// items a subtree needs to be split into parallel tasks.
+buckshot_status buckshot_set_thread_count(size_t thread_count);
+void buckshot_set_parallel_cutoff(int subtree_depth);
+// Answers positions covered by a tablebase file without search (see src/tablebase.hpp).
+buckshot_status buckshot_open_tablebase(const char *path);
+
+int buckshot_stats_enabled(void);
+void buckshot_reset_stats(void);
+void buckshot_get_stats(buckshot_stats *stats);
+
+// Since version 2. Create returns NULL if out of memory. A shared context searches on the caches
+// of other, with threads and counters of its own. Destroy a context only while it is not
+// searching; caches shared with other contexts live on with them.
+buckshot_context *buckshot_context_create(size_t hash_size_mb, size_t thread_count);
+buckshot_context *buckshot_context_create_shared(const buckshot_context *other,
+                                                 size_t thread_count);
+void buckshot_context_destroy(buckshot_context *context);
+buckshot_status buckshot_context_get_best_action(buckshot_context *context,
+                                                 buckshot_position position,
+                                                 const buckshot_search_options *options,
+                                                 buckshot_result *result);
+buckshot_status buckshot_context_get_ev(buckshot_context *context, buckshot_position position,
+                                        float *ev);
+void buckshot_context_clear_hash(buckshot_context *context);
+void buckshot_context_reset_stats(buckshot_context *context);
+void buckshot_context_get_stats(buckshot_context *context, buckshot_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // BUCKSHOT_ROULETTE_H
@@ -1,579 +1,1544 @@
 #include "expectimax.hpp"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <functional>
 #include <limits>
 #include <optional>
-
+#include <type_traits>
+#include <vector>
+
+#include "search_context.hpp"
+#include "search_stats.hpp"
+#include "state_index.hpp"
+#include "tablebase.hpp"
+#include "task_scheduler.hpp"
 #include "transposition_table.hpp"
 
-TranspositionTableManager tt_manager;
+// Nodes each thread counts locally before charging them to the node budget and checking the clock.
+constexpr uint32_t SEARCH_LIMITS_CHECK_INTERVAL = 1024;
+
+// State of a budgeted search. Every thread working on it reaches it through current_limits, which
+// fork points hand on to the tasks they spawn. Unbudgeted searches run without one and are exact.
+struct SearchLimits {
+	// Positions with this many shells or fewer are estimated instead of searched.
+	int cutoff_shell_count = 0;
+	bool has_deadline = false;
+	std::chrono::steady_clock::time_point deadline;
+	uint64_t node_budget = 0;
+	// Off for the first iteration, so that there is always a move to return.
+	bool can_abort = false;
+	std::atomic<uint64_t> node_count{0};
+	std::atomic<bool> is_aborted{false};
+	std::atomic<bool> is_truncated{false};
+};
+
+static thread_local SearchLimits *current_limits = nullptr;
+static thread_local uint32_t unchecked_node_count = 0;
+
+// Makes limits the ones of the calling thread until the scope ends.
+class SearchLimitsScope final {
+   public:
+	explicit SearchLimitsScope(SearchLimits *limits) : saved_limits(current_limits) {
+		current_limits = limits;
+	}
+	~SearchLimitsScope(void) { current_limits = this->saved_limits; }
+
+   private:
+	SearchLimits *saved_limits;
+};
+
+// Context of the search the calling thread works on, see SearchContext.
+static thread_local SearchContext *current_context = nullptr;
+
+// Makes context the one of the calling thread until the scope ends, and counts into it.
+class SearchContextScope final {
+   public:
+	explicit SearchContextScope(SearchContext &context)
+	    : saved_context(current_context), saved_counters(current_search_counters) {
+		current_context = &context;
+		if constexpr (SEARCH_STATS_ENABLED) {
+			current_search_counters = &context.get_counters().get_thread_counters();
+		}
+	}
+	~SearchContextScope(void) {
+		current_context = this->saved_context;
+		current_search_counters = this->saved_counters;
+	}
+
+   private:
+	SearchContext *saved_context;
+	SearchCounters *saved_counters;
+};
+
+// Set while Node::expand() searches a single ply, see ChildVisitor.
+static thread_local ChildVisitor *current_child_visitor = nullptr;
+
+class ChildVisitorScope final {
+   public:
+	explicit ChildVisitorScope(ChildVisitor *visitor) : saved_visitor(current_child_visitor) {
+		current_child_visitor = visitor;
+	}
+	~ChildVisitorScope(void) { current_child_visitor = this->saved_visitor; }
+
+   private:
+	ChildVisitor *saved_visitor;
+};
+
+// Items each side is dealt with every load of a life tier, as in the three rounds of the game.
+constexpr int get_items_per_load(int max_lives) {
+	return max_lives == 2 ? 0 : max_lives == 4 ? 2 : 4;
+}
+constexpr int MAX_ITEMS_PER_LOAD = get_items_per_load(6);
+
+// One way the items of a load can come out, every item being of a uniformly random classic kind.
+struct ItemGrant {
+	uint64_t items;  // packed as in ItemManager, added to the items in hand
+	float probability;
+};
+
+// The grants of count items for count = 0 to MAX_ITEMS_PER_LOAD, as multisets of kinds with their
+// multinomial probabilities. Orders of the same kinds make the same position, so they are merged.
+static const std::array<std::vector<ItemGrant>, MAX_ITEMS_PER_LOAD + 1> &get_item_grants(void) {
+	static const std::array<std::vector<ItemGrant>, MAX_ITEMS_PER_LOAD + 1> item_grants = [] {
+		std::array<std::vector<ItemGrant>, MAX_ITEMS_PER_LOAD + 1> grants;
+		for (int count = 0; count <= MAX_ITEMS_PER_LOAD; ++count) {
+			std::array<int, CLASSIC_ITEM_KIND_COUNT> kind_counts = {};
+			// Walks the multisets by their kind counts, each one being count! / prod(kind count!)
+			// of the CLASSIC_ITEM_KIND_COUNT^count equally likely sequences.
+			std::function<void(int, int)> add_grants = [&](int kind, int remaining_count) {
+				if (kind == CLASSIC_ITEM_KIND_COUNT - 1) {
+					kind_counts[kind] = remaining_count;
+					double sequence_count = 1.0;
+					int item_index = 0;
+					uint64_t items = 0;
+					for (int i = 0; i < CLASSIC_ITEM_KIND_COUNT; ++i) {
+						for (int j = 1; j <= kind_counts[i]; ++j) {
+							sequence_count = sequence_count * ++item_index / j;
+						}
+						items += static_cast<uint64_t>(kind_counts[i]) << (i * ITEM_KIND_BITS);
+					}
+					grants[count].push_back(ItemGrant{
+					    items, static_cast<float>(sequence_count /
+					                              std::pow(CLASSIC_ITEM_KIND_COUNT, count))});
+					return;
+				}
+				for (int kind_count = 0; kind_count <= remaining_count; ++kind_count) {
+					kind_counts[kind] = kind_count;
+					add_grants(kind + 1, remaining_count - kind_count);
+				}
+			};
+			add_grants(0, count);
+		}
+		return grants;
+	}();
+	return item_grants;
+}
+
+// Items a side holding held_item_count items gets from a double or nothing load on average.
+static float get_expected_double_or_nothing_grant(int held_item_count) {
+	const int free_slot_count = std::max(0, MAX_HELD_ITEM_COUNT - held_item_count);
+	int item_count_sum = 0;
+	for (int count = 1; count <= DOUBLE_OR_NOTHING_MAX_ITEMS_PER_LOAD; ++count) {
+		item_count_sum += std::min(count, free_slot_count);
+	}
+	return static_cast<float>(item_count_sum) / DOUBLE_OR_NOTHING_MAX_ITEMS_PER_LOAD;
+}
+
+// Counts a node against the budget. Returns whether the search has been aborted, in which case
+// every node on the way up returns a meaningless EV that the caller throws away.
+static bool is_out_of_budget(SearchLimits &limits) {
+	if (limits.is_aborted.load(std::memory_order_relaxed)) {
+		return true;
+	}
+	if (++unchecked_node_count < SEARCH_LIMITS_CHECK_INTERVAL) {
+		return false;
+	}
+	unchecked_node_count = 0;
+
+	const uint64_t node_count =
+	    limits.node_count.fetch_add(SEARCH_LIMITS_CHECK_INTERVAL, std::memory_order_relaxed) +
+	    SEARCH_LIMITS_CHECK_INTERVAL;
+	if (!limits.can_abort) {
+		return false;
+	}
+	if ((limits.node_budget != 0 && node_count >= limits.node_budget) ||
+	    (limits.has_deadline && std::chrono::steady_clock::now() >= limits.deadline)) {
+		limits.is_aborted.store(true, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
+
+// Stores the EV of a searched node at the cutoff it was searched with. EVs of an aborted search are
+// not kept.
+static void store_ev(const Node &node, float ev) {
+	const SearchLimits *limits = current_limits;
+	if (current_child_visitor) {
+		return;
+	}
+	if (!limits) {
+		current_context->get_table().add_node(node, ev);
+	}
+	else if (!limits->is_aborted.load(std::memory_order_relaxed)) {
+		current_context->get_table().add_node(node, ev, limits->cutoff_shell_count);
+	}
+}
+
+// Runs branch(0) to branch(N - 1) of a fork point as tasks on the scheduler of the context and
+// helps out while waiting, the caller usually picks up the last one itself. Callers combine the
+// results in a fixed order afterwards, so the EV does not depend on which thread ran what.
+template <std::size_t N, typename Branch>
+static void fork_join(Branch &&branch) {
+	SearchContext *context = current_context;
+	SearchLimits *limits = current_limits;
+	TaskGroup group(*context->get_scheduler());
+	for (std::size_t i = 0; i < N; ++i) {
+		group.spawn([context, limits, &branch, i] {
+			SearchContextScope context_scope(*context);
+			SearchLimitsScope limits_scope(limits);
+			branch(i);
+		});
+	}
+	group.wait();
+}
+
+// Searches the outcomes of a chance node, search(i) returning the weighted EV of outcome i, as
+// forked tasks if should_fork is set. Outcomes of probability 0 are skipped and keep their
+// weighted EV.
+template <std::size_t N, typename Search>
+static void search_chance_outcomes(bool should_fork, const std::array<float, N> &probabilities,
+                                   std::array<float, N> &weighted_evs, Search &&search) {
+	auto search_outcome = [&](std::size_t i) {
+		if (probabilities[i] > 0.0f) {
+			weighted_evs[i] = search(i);
+		}
+	};
+	if (should_fork) {
+		fork_join<N>(search_outcome);
+	}
+	else {
+		for (std::size_t i = 0; i < N; ++i) {
+			search_outcome(i);
+		}
+	}
+}
+
+// Calls function with the life tier and the side to move as std::integral_constants, which selects
+// the search code specialized for them. Only the 2, 4 and 6 life tiers of the game exist.
+template <typename Function>
+static decltype(auto) dispatch_kernel(int max_lives, bool is_dealer_turn, Function &&function) {
+	using DealerTurn = std::true_type;
+	using PlayerTurn = std::false_type;
+	switch (max_lives) {
+		case 2:
+			return is_dealer_turn ? function(std::integral_constant<int, 2>{}, DealerTurn{})
+			                      : function(std::integral_constant<int, 2>{}, PlayerTurn{});
+		case 4:
+			return is_dealer_turn ? function(std::integral_constant<int, 4>{}, DealerTurn{})
+			                      : function(std::integral_constant<int, 4>{}, PlayerTurn{});
+		default:
+			assert(max_lives == 6);
+			return is_dealer_turn ? function(std::integral_constant<int, 6>{}, DealerTurn{})
+			                      : function(std::integral_constant<int, 6>{}, PlayerTurn{});
+	}
+}
 
 Node::Node(bool is_dealer_turn, bool curr_is_live, bool curr_is_blank, uint8_t live_round_count,
            uint8_t blank_round_count, uint8_t max_lives, uint8_t dealer_lives, uint8_t player_lives,
-           ItemManager dealer_items, ItemManager player_items)
-    : is_dealer_turn(is_dealer_turn),
-      curr_is_live(curr_is_live),
-      curr_is_blank(curr_is_blank),
-      live_round_count(live_round_count),
-      blank_round_count(blank_round_count),
-      max_lives(max_lives),
-      dealer_lives(dealer_lives),
-      player_lives(player_lives),
-      dealer_items(dealer_items),
-      player_items(player_items),
-      handsaw_applied(false),
-      handcuffs_applied(false),
-      handcuffs_available(true) {}
-
-bool Node::operator==(const Node &other) const {
-	return this->dealer_items == other.dealer_items && this->player_items == other.player_items &&
-	       this->live_round_count == other.live_round_count &&
-	       this->blank_round_count == other.blank_round_count &&
-	       this->max_lives == other.max_lives && this->dealer_lives == other.dealer_lives &&
-	       this->player_lives == other.player_lives &&
-	       this->is_dealer_turn == other.is_dealer_turn &&
-	       this->curr_is_live == other.curr_is_live && this->curr_is_blank == other.curr_is_blank;
+           ItemManager dealer_items, ItemManager player_items, bool handsaw_applied,
+           bool handcuffs_applied, bool handcuffs_available, bool is_reload_pending,
+           bool is_double_or_nothing) {
+	assert(live_round_count < (1 << SHELL_COUNT_WIDTH));
+	assert(blank_round_count < (1 << SHELL_COUNT_WIDTH));
+	assert(max_lives == 2 || max_lives == 4 || max_lives == 6);
+	assert(dealer_lives <= max_lives && player_lives <= max_lives);
+
+	this->set_field<DEALER_ITEMS_SHIFT, ITEMS_WIDTH>(get_item_bits(dealer_items));
+	this->set_field<PLAYER_ITEMS_SHIFT, ITEMS_WIDTH>(get_item_bits(player_items));
+	this->set_field<LIVE_ROUND_COUNT_SHIFT, SHELL_COUNT_WIDTH>(live_round_count);
+	this->set_field<BLANK_ROUND_COUNT_SHIFT, SHELL_COUNT_WIDTH>(blank_round_count);
+	this->set_field<MAX_LIVES_SHIFT, MAX_LIVES_WIDTH>(max_lives / 2);
+	this->set_field<DEALER_LIVES_SHIFT, LIVES_WIDTH>(dealer_lives);
+	this->set_field<PLAYER_LIVES_SHIFT, LIVES_WIDTH>(player_lives);
+	this->set_field<DEALER_TURN_SHIFT, 1>(is_dealer_turn);
+	this->set_field<CURR_IS_LIVE_SHIFT, 1>(curr_is_live);
+	this->set_field<CURR_IS_BLANK_SHIFT, 1>(curr_is_blank);
+	this->set_field<HANDSAW_APPLIED_SHIFT, 1>(handsaw_applied);
+	this->set_field<HANDCUFFS_APPLIED_SHIFT, 1>(handcuffs_applied);
+	this->set_field<HANDCUFFS_AVAILABLE_SHIFT, 1>(handcuffs_available);
+	this->set_field<RELOAD_PENDING_SHIFT, 1>(is_reload_pending);
+	this->set_field<DOUBLE_OR_NOTHING_SHIFT, 1>(is_double_or_nothing);
+}
+
+template <bool IsLive>
+void Node::flip_counted_round(void) {
+	constexpr int from_shift = IsLive ? LIVE_ROUND_COUNT_SHIFT : BLANK_ROUND_COUNT_SHIFT;
+	constexpr int to_shift = IsLive ? BLANK_ROUND_COUNT_SHIFT : LIVE_ROUND_COUNT_SHIFT;
+	assert((this->get_field<from_shift, SHELL_COUNT_WIDTH>()) > 0);
+	this->state = this->state - (uint64_t{1} << from_shift) + (uint64_t{1} << to_shift);
+	this->set_field<ROUND_INVERTED_SHIFT, 1>(false);
 }
 
+template <bool IsLive>
+void Node::reveal_round(void) {
+	// An inverted round shows the type it hits as, so it is counted as that from now on.
+	const bool is_inverted = this->is_round_inverted();
+	if (is_inverted) {
+		this->flip_counted_round<IsLive>();
+	}
+	this->set_field<CURR_IS_LIVE_SHIFT, 1>(IsLive != is_inverted);
+	this->set_field<CURR_IS_BLANK_SHIFT, 1>(IsLive == is_inverted);
+}
+
+// The shots take the round as it is counted. An inverted round is moved to the other count first,
+// and then hits as that type.
+template <int MaxLives, bool IsDealerTurn>
 void Node::apply_shoot_dealer_live(void) {
-	assert(this->dealer_lives > 0);
-	assert(this->live_round_count > 0);
+	if (this->is_round_inverted()) {
+		this->flip_counted_round<true>();
+		this->apply_shoot_dealer_blank<MaxLives, IsDealerTurn>();
+		return;
+	}
 
-	if (this->handsaw_applied || this->dealer_is_fade_charge()) {
-		this->dealer_lives -= dealer_lives == 1 ? 1 : 2;
+	const int dealer_lives = this->get_dealer_lives();
+	assert(dealer_lives > 0);
+	assert(this->get_live_round_count() > 0);
+
+	if (this->is_handsaw_applied() || this->dealer_is_fade_charge<MaxLives>()) {
+		this->set_field<DEALER_LIVES_SHIFT, LIVES_WIDTH>(dealer_lives -
+		                                                 (dealer_lives == 1 ? 1 : 2));
 	}
 	else {
-		this->dealer_lives--;
+		this->set_field<DEALER_LIVES_SHIFT, LIVES_WIDTH>(dealer_lives - 1);
 	}
-	this->live_round_count--;
-	this->curr_is_live = false;
-	this->curr_is_blank = false;
-	this->handsaw_applied = false;
-
-	if (this->handcuffs_applied) {
-		this->handcuffs_applied = false;
-		this->handcuffs_available = false;
+	this->set_field<LIVE_ROUND_COUNT_SHIFT, SHELL_COUNT_WIDTH>(this->get_live_round_count() - 1);
+	this->set_field<CURR_IS_LIVE_SHIFT, 1>(false);
+	this->set_field<CURR_IS_BLANK_SHIFT, 1>(false);
+	this->set_field<HANDSAW_APPLIED_SHIFT, 1>(false);
+
+	if (this->is_handcuffs_applied()) {
+		this->set_field<HANDCUFFS_APPLIED_SHIFT, 1>(false);
+		this->set_field<HANDCUFFS_AVAILABLE_SHIFT, 1>(false);
 	}
 	else {
-		this->is_dealer_turn = !this->is_dealer_turn;
-		this->handcuffs_available = true;
+		this->set_field<DEALER_TURN_SHIFT, 1>(!IsDealerTurn);
+		this->set_field<HANDCUFFS_AVAILABLE_SHIFT, 1>(true);
 	}
 }
 
+template <int MaxLives, bool IsDealerTurn>
 void Node::apply_shoot_dealer_blank(void) {
-	assert(this->blank_round_count > 0);
+	if (this->is_round_inverted()) {
+		this->flip_counted_round<false>();
+		this->apply_shoot_dealer_live<MaxLives, IsDealerTurn>();
+		return;
+	}
+	assert(this->get_blank_round_count() > 0);
 
-	this->blank_round_count--;
-	this->curr_is_live = false;
-	this->curr_is_blank = false;
-	this->handsaw_applied = false;
+	this->set_field<BLANK_ROUND_COUNT_SHIFT, SHELL_COUNT_WIDTH>(this->get_blank_round_count() - 1);
+	this->set_field<CURR_IS_LIVE_SHIFT, 1>(false);
+	this->set_field<CURR_IS_BLANK_SHIFT, 1>(false);
+	this->set_field<HANDSAW_APPLIED_SHIFT, 1>(false);
 
-	if (this->handcuffs_applied) {
-		this->handcuffs_applied = false;
-		this->handcuffs_available = false;
+	if (this->is_handcuffs_applied()) {
+		this->set_field<HANDCUFFS_APPLIED_SHIFT, 1>(false);
+		this->set_field<HANDCUFFS_AVAILABLE_SHIFT, 1>(false);
 	}
 	else {
-		this->is_dealer_turn = true;
-		this->handcuffs_available = true;
+		this->set_field<DEALER_TURN_SHIFT, 1>(true);
+		this->set_field<HANDCUFFS_AVAILABLE_SHIFT, 1>(true);
 	}
 }
 
+template <int MaxLives>
 bool Node::player_is_fade_charge(void) const {
-	return this->max_lives == 6 && this->player_lives <= 2;
+	return MaxLives == 6 && this->get_player_lives() <= 2;
 }
 
+template <int MaxLives>
 bool Node::dealer_is_fade_charge(void) const {
-	return this->max_lives == 6 && this->dealer_lives <= 2;
+	return MaxLives == 6 && this->get_dealer_lives() <= 2;
 }
 
+template <int MaxLives, bool IsDealerTurn>
 void Node::apply_shoot_player_live(void) {
-	assert(this->player_lives > 0);
-	assert(this->live_round_count > 0);
+	if (this->is_round_inverted()) {
+		this->flip_counted_round<true>();
+		this->apply_shoot_player_blank<MaxLives, IsDealerTurn>();
+		return;
+	}
+	assert(this->get_player_lives() > 0);
+	assert(this->get_live_round_count() > 0);
 
-	if (this->is_dealer_turn && this->dealer_items.has_handsaw() && !this->handsaw_applied) {
-		this->apply_use_handsaw();
+	if (IsDealerTurn && this->get_dealer_items().has<ItemKind::HANDSAW>() &&
+	    !this->is_handsaw_applied()) {
+		this->apply_use_handsaw<MaxLives, IsDealerTurn>();
 	}
 
-	if (this->handsaw_applied || this->player_is_fade_charge()) {
-		this->player_lives -= this->player_lives == 1 ? 1 : 2;
+	const int player_lives = this->get_player_lives();
+	if (this->is_handsaw_applied() || this->player_is_fade_charge<MaxLives>()) {
+		this->set_field<PLAYER_LIVES_SHIFT, LIVES_WIDTH>(player_lives -
+		                                                 (player_lives == 1 ? 1 : 2));
 	}
 	else {
-		this->player_lives--;
+		this->set_field<PLAYER_LIVES_SHIFT, LIVES_WIDTH>(player_lives - 1);
 	}
 
-	this->live_round_count--;
-	this->curr_is_live = false;
-	this->curr_is_blank = false;
-	this->handsaw_applied = false;
+	this->set_field<LIVE_ROUND_COUNT_SHIFT, SHELL_COUNT_WIDTH>(this->get_live_round_count() - 1);
+	this->set_field<CURR_IS_LIVE_SHIFT, 1>(false);
+	this->set_field<CURR_IS_BLANK_SHIFT, 1>(false);
+	this->set_field<HANDSAW_APPLIED_SHIFT, 1>(false);
 
-	if (this->handcuffs_applied) {
-		this->handcuffs_applied = false;
-		this->handcuffs_available = false;
+	if (this->is_handcuffs_applied()) {
+		this->set_field<HANDCUFFS_APPLIED_SHIFT, 1>(false);
+		this->set_field<HANDCUFFS_AVAILABLE_SHIFT, 1>(false);
 	}
 	else {
-		this->is_dealer_turn = !this->is_dealer_turn;
-		this->handcuffs_available = true;
+		this->set_field<DEALER_TURN_SHIFT, 1>(!IsDealerTurn);
+		this->set_field<HANDCUFFS_AVAILABLE_SHIFT, 1>(true);
 	}
 }
 
+template <int MaxLives, bool IsDealerTurn>
 void Node::apply_shoot_player_blank(void) {
-	assert(blank_round_count > 0);
+	if (this->is_round_inverted()) {
+		this->flip_counted_round<false>();
+		this->apply_shoot_player_live<MaxLives, IsDealerTurn>();
+		return;
+	}
+	assert(this->get_blank_round_count() > 0);
 
-	if (this->is_dealer_turn && this->dealer_items.has_handsaw() && !this->handsaw_applied) {
-		this->apply_use_handsaw();
+	if (IsDealerTurn && this->get_dealer_items().has<ItemKind::HANDSAW>() &&
+	    !this->is_handsaw_applied()) {
+		this->apply_use_handsaw<MaxLives, IsDealerTurn>();
 	}
 
-	this->blank_round_count--;
-	this->curr_is_live = false;
-	this->curr_is_blank = false;
-	this->handsaw_applied = false;
+	this->set_field<BLANK_ROUND_COUNT_SHIFT, SHELL_COUNT_WIDTH>(this->get_blank_round_count() - 1);
+	this->set_field<CURR_IS_LIVE_SHIFT, 1>(false);
+	this->set_field<CURR_IS_BLANK_SHIFT, 1>(false);
+	this->set_field<HANDSAW_APPLIED_SHIFT, 1>(false);
 
-	if (this->handcuffs_applied) {
-		this->handcuffs_applied = false;
-		this->handcuffs_available = false;
+	if (this->is_handcuffs_applied()) {
+		this->set_field<HANDCUFFS_APPLIED_SHIFT, 1>(false);
+		this->set_field<HANDCUFFS_AVAILABLE_SHIFT, 1>(false);
 	}
 	else {
-		this->is_dealer_turn = false;
-		this->handcuffs_available = true;
+		this->set_field<DEALER_TURN_SHIFT, 1>(false);
+		this->set_field<HANDCUFFS_AVAILABLE_SHIFT, 1>(true);
 	}
 }
 
-void Node::apply_drink_beer_live(void) {
-	assert(this->live_round_count > 0);
-
-	this->live_round_count--;
-	this->curr_is_live = false;
-	this->curr_is_blank = false;
-
-	if (this->is_dealer_turn) {
-		this->dealer_items.remove_beer();
+template <ItemKind Kind, bool IsDealerTurn>
+void Node::remove_acting_item(void) {
+	// The acting side only picks which half of the items to update. An item taken with adrenaline
+	// comes from the other half, picked without a branch, and ends the adrenaline. Classic kinds
+	// move to the rank without the item, later ones are decremented in place.
+	constexpr int own_shift = IsDealerTurn ? DEALER_ITEMS_SHIFT : PLAYER_ITEMS_SHIFT;
+	constexpr int other_shift = IsDealerTurn ? PLAYER_ITEMS_SHIFT : DEALER_ITEMS_SHIFT;
+	constexpr int kind = static_cast<int>(Kind);
+	const int is_stolen = static_cast<int>(this->get_field<ADRENALINE_APPLIED_SHIFT, 1>());
+	const int items_shift = own_shift + is_stolen * (other_shift - own_shift);
+	assert((IsDealerTurn != static_cast<bool>(is_stolen) ? this->get_dealer_items()
+	                                                     : this->get_player_items())
+	           .template has<Kind>());
+	if constexpr (kind < CLASSIC_ITEM_KIND_COUNT) {
+		const uint64_t rank = this->state >> items_shift & CLASSIC_RANK_MASK;
+		this->state ^= (rank ^ CLASSIC_INVENTORY_TABLE.removed[rank][kind]) << items_shift;
 	}
 	else {
-		this->player_items.remove_beer();
+		this->state -= uint64_t{1} << (items_shift + CLASSIC_RANK_WIDTH +
+		                               (kind - CLASSIC_ITEM_KIND_COUNT) * LATER_ITEM_FIELD_WIDTH);
 	}
+	this->state &= ~field_mask<ADRENALINE_APPLIED_SHIFT, 1>();
 }
 
-void Node::apply_drink_beer_blank(void) {
-	this->blank_round_count--;
-	this->curr_is_live = false;
-	this->curr_is_blank = false;
+template <int MaxLives, bool IsDealerTurn>
+void Node::apply_drink_beer_live(void) {
+	assert(this->get_live_round_count() > 0);
 
-	if (this->is_dealer_turn) {
-		this->dealer_items.remove_beer();
-	}
-	else {
-		this->player_items.remove_beer();
-	}
+	this->set_field<LIVE_ROUND_COUNT_SHIFT, SHELL_COUNT_WIDTH>(this->get_live_round_count() - 1);
+	this->set_field<CURR_IS_LIVE_SHIFT, 1>(false);
+	this->set_field<CURR_IS_BLANK_SHIFT, 1>(false);
+	this->set_field<ROUND_INVERTED_SHIFT, 1>(false);
+	this->remove_acting_item<ItemKind::BEER, IsDealerTurn>();
+}
+
+template <int MaxLives, bool IsDealerTurn>
+void Node::apply_drink_beer_blank(void) {
+	this->set_field<BLANK_ROUND_COUNT_SHIFT, SHELL_COUNT_WIDTH>(this->get_blank_round_count() - 1);
+	this->set_field<CURR_IS_LIVE_SHIFT, 1>(false);
+	this->set_field<CURR_IS_BLANK_SHIFT, 1>(false);
+	this->set_field<ROUND_INVERTED_SHIFT, 1>(false);
+	this->remove_acting_item<ItemKind::BEER, IsDealerTurn>();
 }
 
+template <int MaxLives, bool IsDealerTurn>
 void Node::apply_smoke_cigarette(void) {
-	if (this->is_dealer_turn) {
-		assert(this->dealer_lives < this->max_lives);
-		if (!this->dealer_is_fade_charge()) {
-			this->dealer_lives++;
+	if constexpr (IsDealerTurn) {
+		assert(this->get_dealer_lives() < MaxLives);
+		if (!this->dealer_is_fade_charge<MaxLives>()) {
+			this->set_field<DEALER_LIVES_SHIFT, LIVES_WIDTH>(this->get_dealer_lives() + 1);
 		}
-		this->dealer_items.remove_cigarette_pack();
 	}
 	else {
-		assert(this->player_lives < this->max_lives);
-		assert(!this->player_is_fade_charge());
-		this->player_lives++;
-		this->player_items.remove_cigarette_pack();
+		assert(this->get_player_lives() < MaxLives);
+		assert(!this->player_is_fade_charge<MaxLives>());
+		this->set_field<PLAYER_LIVES_SHIFT, LIVES_WIDTH>(this->get_player_lives() + 1);
 	}
+	this->remove_acting_item<ItemKind::CIGARETTE_PACK, IsDealerTurn>();
 }
 
+template <int MaxLives, bool IsDealerTurn>
 void Node::apply_magnify_live(void) {
-	this->curr_is_live = true;
-	this->curr_is_blank = false;
+	this->reveal_round<true>();
+	this->remove_acting_item<ItemKind::MAGNIFYING_GLASS, IsDealerTurn>();
+}
+
+template <int MaxLives, bool IsDealerTurn>
+void Node::apply_magnify_blank(void) {
+	this->reveal_round<false>();
+	this->remove_acting_item<ItemKind::MAGNIFYING_GLASS, IsDealerTurn>();
+}
+
+template <int MaxLives, bool IsDealerTurn>
+void Node::apply_use_handsaw(void) {
+	this->set_field<HANDSAW_APPLIED_SHIFT, 1>(true);
+	this->remove_acting_item<ItemKind::HANDSAW, IsDealerTurn>();
+}
+
+template <int MaxLives, bool IsDealerTurn>
+void Node::apply_use_handcuffs(void) {
+	this->set_field<HANDCUFFS_APPLIED_SHIFT, 1>(true);
+	this->remove_acting_item<ItemKind::HANDCUFFS, IsDealerTurn>();
+}
+
+template <int MaxLives, bool IsDealerTurn>
+void Node::apply_use_adrenaline(void) {
+	assert(!this->is_adrenaline_applied());
+	this->remove_acting_item<ItemKind::ADRENALINE, IsDealerTurn>();
+	this->set_field<ADRENALINE_APPLIED_SHIFT, 1>(true);
+}
 
-	if (this->is_dealer_turn) {
-		this->dealer_items.remove_magnifying_glass();
+template <int MaxLives, bool IsDealerTurn>
+void Node::apply_use_inverter(void) {
+	// A round of a known type changes count and stays known. Nobody knows what an unknown round
+	// was, so it only gets marked, and inverting it again takes the mark off.
+	if (this->round_known_live() || this->is_only_live_rounds()) {
+		this->flip_counted_round<true>();
+		this->set_field<CURR_IS_LIVE_SHIFT, 1>(false);
+		this->set_field<CURR_IS_BLANK_SHIFT, 1>(true);
+	}
+	else if (this->round_known_blank() || this->is_only_blank_rounds()) {
+		this->flip_counted_round<false>();
+		this->set_field<CURR_IS_LIVE_SHIFT, 1>(true);
+		this->set_field<CURR_IS_BLANK_SHIFT, 1>(false);
 	}
 	else {
-		this->player_items.remove_magnifying_glass();
+		this->state ^= field_mask<ROUND_INVERTED_SHIFT, 1>();
 	}
+	this->remove_acting_item<ItemKind::INVERTER, IsDealerTurn>();
 }
 
-void Node::apply_magnify_blank(void) {
-	this->curr_is_live = false;
-	this->curr_is_blank = true;
-
-	if (this->is_dealer_turn) {
-		this->dealer_items.remove_magnifying_glass();
+// Expired medicine heals 2 lives (no more than cigarettes past a fade charge) or takes one.
+template <int MaxLives, bool IsDealerTurn>
+void Node::apply_expired_medicine_heal(void) {
+	if constexpr (IsDealerTurn) {
+		if (!this->dealer_is_fade_charge<MaxLives>()) {
+			this->set_field<DEALER_LIVES_SHIFT, LIVES_WIDTH>(
+			    std::min(MaxLives, this->get_dealer_lives() + 2));
+		}
 	}
 	else {
-		this->player_items.remove_magnifying_glass();
+		assert(!this->player_is_fade_charge<MaxLives>());
+		this->set_field<PLAYER_LIVES_SHIFT, LIVES_WIDTH>(
+		    std::min(MaxLives, this->get_player_lives() + 2));
 	}
+	this->remove_acting_item<ItemKind::EXPIRED_MEDICINE, IsDealerTurn>();
 }
 
-void Node::apply_use_handsaw(void) {
-	this->handsaw_applied = true;
-
-	if (this->is_dealer_turn) {
-		this->dealer_items.remove_handsaw();
+template <int MaxLives, bool IsDealerTurn>
+void Node::apply_expired_medicine_damage(void) {
+	if constexpr (IsDealerTurn) {
+		this->set_field<DEALER_LIVES_SHIFT, LIVES_WIDTH>(this->get_dealer_lives() - 1);
 	}
 	else {
-		this->player_items.remove_handsaw();
+		this->set_field<PLAYER_LIVES_SHIFT, LIVES_WIDTH>(this->get_player_lives() - 1);
 	}
+	this->remove_acting_item<ItemKind::EXPIRED_MEDICINE, IsDealerTurn>();
+}
+
+template <int MaxLives, bool IsDealerTurn>
+void Node::apply_burner_phone_live(void) {
+	assert(this->get_live_round_count() + this->get_blank_round_count() == 2);
+	this->reveal_round<true>();
+	this->remove_acting_item<ItemKind::BURNER_PHONE, IsDealerTurn>();
+}
+
+template <int MaxLives, bool IsDealerTurn>
+void Node::apply_burner_phone_blank(void) {
+	assert(this->get_live_round_count() + this->get_blank_round_count() == 2);
+	this->reveal_round<false>();
+	this->remove_acting_item<ItemKind::BURNER_PHONE, IsDealerTurn>();
+}
+
+void Node::apply_shoot_dealer_live(void) {
+	dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                [this](auto max_lives, auto is_dealer_turn) {
+		                this->apply_shoot_dealer_live<max_lives, is_dealer_turn>();
+	                });
+}
+
+void Node::apply_shoot_dealer_blank(void) {
+	dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                [this](auto max_lives, auto is_dealer_turn) {
+		                this->apply_shoot_dealer_blank<max_lives, is_dealer_turn>();
+	                });
+}
+
+void Node::apply_shoot_player_live(void) {
+	dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                [this](auto max_lives, auto is_dealer_turn) {
+		                this->apply_shoot_player_live<max_lives, is_dealer_turn>();
+	                });
+}
+
+void Node::apply_shoot_player_blank(void) {
+	dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                [this](auto max_lives, auto is_dealer_turn) {
+		                this->apply_shoot_player_blank<max_lives, is_dealer_turn>();
+	                });
+}
+
+void Node::apply_drink_beer_live(void) {
+	dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                [this](auto max_lives, auto is_dealer_turn) {
+		                this->apply_drink_beer_live<max_lives, is_dealer_turn>();
+	                });
+}
+
+void Node::apply_drink_beer_blank(void) {
+	dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                [this](auto max_lives, auto is_dealer_turn) {
+		                this->apply_drink_beer_blank<max_lives, is_dealer_turn>();
+	                });
+}
+
+void Node::apply_smoke_cigarette(void) {
+	dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                [this](auto max_lives, auto is_dealer_turn) {
+		                this->apply_smoke_cigarette<max_lives, is_dealer_turn>();
+	                });
+}
+
+void Node::apply_magnify_live(void) {
+	dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                [this](auto max_lives, auto is_dealer_turn) {
+		                this->apply_magnify_live<max_lives, is_dealer_turn>();
+	                });
+}
+
+void Node::apply_magnify_blank(void) {
+	dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                [this](auto max_lives, auto is_dealer_turn) {
+		                this->apply_magnify_blank<max_lives, is_dealer_turn>();
+	                });
+}
+
+void Node::apply_use_handsaw(void) {
+	dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                [this](auto max_lives, auto is_dealer_turn) {
+		                this->apply_use_handsaw<max_lives, is_dealer_turn>();
+	                });
 }
 
 void Node::apply_use_handcuffs(void) {
-	this->handcuffs_applied = true;
+	dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                [this](auto max_lives, auto is_dealer_turn) {
+		                this->apply_use_handcuffs<max_lives, is_dealer_turn>();
+	                });
+}
 
-	if (this->is_dealer_turn) {
-		this->dealer_items.remove_handcuffs();
-	}
-	else {
-		this->player_items.remove_handcuffs();
-	}
+void Node::apply_use_adrenaline(void) {
+	dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                [this](auto max_lives, auto is_dealer_turn) {
+		                this->apply_use_adrenaline<max_lives, is_dealer_turn>();
+	                });
+}
+
+void Node::apply_use_inverter(void) {
+	dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                [this](auto max_lives, auto is_dealer_turn) {
+		                this->apply_use_inverter<max_lives, is_dealer_turn>();
+	                });
+}
+
+void Node::apply_expired_medicine_heal(void) {
+	dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                [this](auto max_lives, auto is_dealer_turn) {
+		                this->apply_expired_medicine_heal<max_lives, is_dealer_turn>();
+	                });
+}
+
+void Node::apply_expired_medicine_damage(void) {
+	dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                [this](auto max_lives, auto is_dealer_turn) {
+		                this->apply_expired_medicine_damage<max_lives, is_dealer_turn>();
+	                });
+}
+
+void Node::apply_burner_phone_live(void) {
+	dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                [this](auto max_lives, auto is_dealer_turn) {
+		                this->apply_burner_phone_live<max_lives, is_dealer_turn>();
+	                });
+}
+
+void Node::apply_burner_phone_blank(void) {
+	dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                [this](auto max_lives, auto is_dealer_turn) {
+		                this->apply_burner_phone_blank<max_lives, is_dealer_turn>();
+	                });
 }
 
 void Node::dealer_remove_magnifying_glass(void) {
-	assert(this->is_dealer_turn);
-	this->dealer_items.remove_magnifying_glass();
+	assert(this->is_dealer_turn());
+	this->remove_acting_item<ItemKind::MAGNIFYING_GLASS, true>();
 }
 
-std::array<Node, 4> Node::get_states_after_shoot(void) const {
-	Node shoot_dealer_live = *this;
-	Node shoot_player_live = *this;
-	Node shoot_dealer_blank = *this;
-	Node shoot_player_blank = *this;
+void Node::dealer_remove_burner_phone(void) {
+	assert(this->is_dealer_turn());
+	this->remove_acting_item<ItemKind::BURNER_PHONE, true>();
+}
 
-	if (this->live_round_count > 0 && this->dealer_lives > 0) {
-		shoot_dealer_live.apply_shoot_dealer_live();
-	}
-	if (this->live_round_count > 0 && this->player_lives > 0) {
-		shoot_player_live.apply_shoot_player_live();
-	}
-	if (this->blank_round_count > 0) {
-		shoot_dealer_blank.apply_shoot_dealer_blank();
-		shoot_player_blank.apply_shoot_player_blank();
+template <int MaxLives, void (Node::*Apply)(void)>
+float Node::search_after(int depth, bool is_forked) {
+	// Forked branches run next to their siblings, so they search a copy and leave this node alone.
+	if (is_forked) {
+		Node child = *this;
+		(child.*Apply)();
+		return child.expectimax<MaxLives>(depth + 1);
 	}
 
-	return {shoot_player_blank, shoot_player_live, shoot_dealer_blank, shoot_dealer_live};
+	const uint64_t saved_state = this->state;
+	(this->*Apply)();
+	const float ev = this->expectimax<MaxLives>(depth + 1);
+	this->state = saved_state;
+	return ev;
 }
 
-float Node::calc_drink_beer_ev(float item_pickup_probability) const {
-	const float probability_live = static_cast<float>(this->live_round_count) /
-	                               (this->live_round_count + this->blank_round_count);
-	const float probability_blank = 1.0f - probability_live;
+// EV of a chance node with two outcomes, each weighted by its probability and then by scale.
+template <int MaxLives, void (Node::*First)(void), void (Node::*Second)(void)>
+float Node::search_chance(float first_probability, float second_probability, float scale,
+                          int depth) {
+	const bool is_forked = this->should_fork();
+	std::array<float, 2> weighted_evs = {};
+	search_chance_outcomes<2>(is_forked, {first_probability, second_probability}, weighted_evs,
+	                          [&](std::size_t i) {
+		                          if (i == 0) {
+			                          return this->search_after<MaxLives, First>(depth, is_forked) *
+			                                 first_probability;
+		                          }
+		                          return this->search_after<MaxLives, Second>(depth, is_forked) *
+		                                 second_probability;
+	                          });
+	return weighted_evs[0] * scale + weighted_evs[1] * scale;
+}
 
-	Node eject_live = *this;
-	Node eject_blank = *this;
+// The calc_*_ev functions return the EV after using the item weighted by item_pickup_probability.
+template <int MaxLives, bool IsDealerTurn>
+float Node::calc_drink_beer_ev(float item_pickup_probability, int depth) {
+	constexpr auto eject_live = &Node::apply_drink_beer_live<MaxLives, IsDealerTurn>;
+	constexpr auto eject_blank = &Node::apply_drink_beer_blank<MaxLives, IsDealerTurn>;
+	const float probability_live = static_cast<float>(this->get_live_round_count()) /
+	                               (this->get_live_round_count() + this->get_blank_round_count());
+	const float probability_blank = 1.0f - probability_live;
+	const bool is_forked = this->should_fork();
 
-	if (this->is_only_live_rounds() || this->curr_is_live) {
-		eject_live.apply_drink_beer_live();
-		return eject_live.expectimax() * item_pickup_probability;
+	if (this->is_only_live_rounds() || this->round_known_live()) {
+		return this->search_after<MaxLives, eject_live>(depth, is_forked) *
+		       item_pickup_probability;
 	}
-	if (this->is_only_blank_rounds() || this->curr_is_blank) {
-		eject_blank.apply_drink_beer_blank();
-		return eject_blank.expectimax() * item_pickup_probability;
+	if (this->is_only_blank_rounds() || this->round_known_blank()) {
+		return this->search_after<MaxLives, eject_blank>(depth, is_forked) *
+		       item_pickup_probability;
 	}
 
-	eject_live.apply_drink_beer_live();
-	eject_blank.apply_drink_beer_blank();
-
-	return eject_live.expectimax() * probability_live * item_pickup_probability +
-	       eject_blank.expectimax() * probability_blank * item_pickup_probability;
+	return this->search_chance<MaxLives, eject_live, eject_blank>(
+	    probability_live, probability_blank, item_pickup_probability, depth);
 }
 
-float Node::calc_smoke_cigarette_ev(float item_pickup_probability) const {
-	Node smoked = *this;
-	smoked.apply_smoke_cigarette();
-	return smoked.expectimax() * item_pickup_probability;
+template <int MaxLives, bool IsDealerTurn>
+float Node::calc_smoke_cigarette_ev(float item_pickup_probability, int depth) {
+	constexpr auto smoke = &Node::apply_smoke_cigarette<MaxLives, IsDealerTurn>;
+	return this->search_after<MaxLives, smoke>(depth, this->should_fork()) *
+	       item_pickup_probability;
 }
 
-float Node::calc_use_magnifying_glass_ev(float item_pickup_probability) const {
-	const float probability_live = static_cast<float>(this->live_round_count) /
-	                               (this->live_round_count + this->blank_round_count);
+template <int MaxLives, bool IsDealerTurn>
+float Node::calc_use_magnifying_glass_ev(float item_pickup_probability, int depth) {
+	constexpr auto magnify_live = &Node::apply_magnify_live<MaxLives, IsDealerTurn>;
+	constexpr auto magnify_blank = &Node::apply_magnify_blank<MaxLives, IsDealerTurn>;
+	const float probability_live = static_cast<float>(this->get_live_round_count()) /
+	                               (this->get_live_round_count() + this->get_blank_round_count());
 	const float probability_blank = 1.0f - probability_live;
+	const bool is_forked = this->should_fork();
 
-	Node magnify_live = *this;
-	Node magnify_blank = *this;
-
-	assert(!this->curr_is_live && !this->curr_is_blank);
+	assert(!this->round_known_live() && !this->round_known_blank());
 
 	if (this->is_only_live_rounds()) {
-		magnify_live.apply_magnify_live();
-		return magnify_live.expectimax() * item_pickup_probability;
+		return this->search_after<MaxLives, magnify_live>(depth, is_forked) *
+		       item_pickup_probability;
 	}
 	if (this->is_only_blank_rounds()) {
-		magnify_blank.apply_magnify_blank();
-		return magnify_blank.expectimax() * item_pickup_probability;
+		return this->search_after<MaxLives, magnify_blank>(depth, is_forked) *
+		       item_pickup_probability;
 	}
 
-	magnify_live.apply_magnify_live();
-	magnify_blank.apply_magnify_blank();
+	return this->search_chance<MaxLives, magnify_live, magnify_blank>(
+	    probability_live, probability_blank, item_pickup_probability, depth);
+}
+
+template <int MaxLives, bool IsDealerTurn>
+float Node::calc_use_handsaw_ev(float item_pickup_probability, int depth) {
+	constexpr auto use_handsaw = &Node::apply_use_handsaw<MaxLives, IsDealerTurn>;
+	return this->search_after<MaxLives, use_handsaw>(depth, this->should_fork()) *
+	       item_pickup_probability;
+}
+
+template <int MaxLives, bool IsDealerTurn>
+float Node::calc_use_handcuffs_ev(float item_pickup_probability, int depth) {
+	constexpr auto use_handcuffs = &Node::apply_use_handcuffs<MaxLives, IsDealerTurn>;
+	return this->search_after<MaxLives, use_handcuffs>(depth, this->should_fork()) *
+	       item_pickup_probability;
+}
+
+template <int MaxLives, bool IsDealerTurn>
+float Node::calc_use_adrenaline_ev(float item_pickup_probability, int depth) {
+	constexpr auto use_adrenaline = &Node::apply_use_adrenaline<MaxLives, IsDealerTurn>;
+	return this->search_after<MaxLives, use_adrenaline>(depth, this->should_fork()) *
+	       item_pickup_probability;
+}
 
-	return magnify_live.expectimax() * probability_live * item_pickup_probability +
-	       magnify_blank.expectimax() * probability_blank * item_pickup_probability;
+template <int MaxLives, bool IsDealerTurn>
+float Node::calc_use_inverter_ev(float item_pickup_probability, int depth) {
+	constexpr auto use_inverter = &Node::apply_use_inverter<MaxLives, IsDealerTurn>;
+	return this->search_after<MaxLives, use_inverter>(depth, this->should_fork()) *
+	       item_pickup_probability;
 }
 
-float Node::calc_use_handsaw_ev(float item_pickup_probability) const {
-	Node applied_handsaw = *this;
-	applied_handsaw.apply_use_handsaw();
-	return applied_handsaw.expectimax() * item_pickup_probability;
+template <int MaxLives, bool IsDealerTurn>
+float Node::calc_use_expired_medicine_ev(float item_pickup_probability, int depth) {
+	constexpr auto heal = &Node::apply_expired_medicine_heal<MaxLives, IsDealerTurn>;
+	constexpr auto damage = &Node::apply_expired_medicine_damage<MaxLives, IsDealerTurn>;
+	return this->search_chance<MaxLives, heal, damage>(0.4f, 0.6f, item_pickup_probability, depth);
 }
 
-float Node::calc_use_handcuffs_ev(float item_pickup_probability) const {
-	Node applied_handcuffs = *this;
-	applied_handcuffs.apply_use_handcuffs();
-	return applied_handcuffs.expectimax() * item_pickup_probability;
+template <int MaxLives, bool IsDealerTurn>
+float Node::calc_use_burner_phone_ev(float item_pickup_probability, int depth) {
+	constexpr auto reveal_live = &Node::apply_burner_phone_live<MaxLives, IsDealerTurn>;
+	constexpr auto reveal_blank = &Node::apply_burner_phone_blank<MaxLives, IsDealerTurn>;
+	assert(this->get_live_round_count() == 1 && this->get_blank_round_count() == 1);
+	return this->search_chance<MaxLives, reveal_live, reveal_blank>(
+	    0.5f, 0.5f, item_pickup_probability, depth);
 }
 
 bool Node::is_only_live_rounds(void) const {
-	return this->live_round_count > 0 && this->blank_round_count == 0;
+	return this->get_live_round_count() > 0 && this->get_blank_round_count() == 0;
 }
 
 bool Node::is_only_blank_rounds(void) const {
-	return this->blank_round_count > 0 && this->live_round_count == 0;
+	return this->get_blank_round_count() > 0 && this->get_live_round_count() == 0;
 }
 
 bool Node::is_last_round(void) const {
-	return (this->live_round_count + this->blank_round_count) == 1;
+	return (this->get_live_round_count() + this->get_blank_round_count()) == 1;
 }
 
 bool Node::is_terminal(void) const {
-	return this->dealer_lives == 0 || this->player_lives == 0 ||
-	       (this->live_round_count + this->blank_round_count) == 0;
+	return this->get_dealer_lives() == 0 || this->get_player_lives() == 0 ||
+	       (this->get_live_round_count() + this->get_blank_round_count()) == 0;
+}
+
+bool Node::can_smoke_cigarette(void) const {
+	if (this->is_dealer_turn()) {
+		return this->get_dealer_lives() < this->get_max_lives();
+	}
+	return this->get_player_lives() < this->get_max_lives() &&
+	       !(this->get_max_lives() == 6 && this->player_is_fade_charge<6>());
 }
 
 float Node::eval(void) const {
 	// TODO: Improve eval
-	return (this->player_lives - this->dealer_lives) * 10;
+	return (this->get_player_lives() - this->get_dealer_lives()) * 10;
 }
 
-float Node::expectimax(void) const {
+float Node::estimate(void) const {
+	// Stands in for a search cut off by a budget: the life difference as in eval(), and a little
+	// for every item in hand, since each one is worth at least a look at a shell or a skipped turn.
+	const int item_difference = this->get_player_item_count() - this->get_dealer_item_count();
+	return this->eval() + static_cast<float>(item_difference);
+}
+
+template <int MaxLives>
+float Node::expectimax(int depth) {
+	count_search_stat(&SearchCounters::nodes);
+	count_search_depth(depth);
+	ChildVisitor *visitor = current_child_visitor;
+
 	if (this->is_terminal()) {
+		if (this->is_reload_pending() && this->get_dealer_lives() > 0 &&
+		    this->get_player_lives() > 0) {
+			return this->reload_expectimax<MaxLives>(depth);
+		}
+		count_search_stat(&SearchCounters::terminal_evals);
+		if (visitor && depth > 0) {
+			visitor->visit_terminal(*this);
+		}
 		return this->eval();
 	}
 
-	if (std::optional<float> ev = tt_manager.get_ev(*this)) {
+	SearchLimits *limits = current_limits;
+	uint8_t cutoff_shell_count = 0;
+	if (limits) {
+		if (is_out_of_budget(*limits)) {
+			return 0.0f;
+		}
+		cutoff_shell_count = limits->cutoff_shell_count;
+		if (this->get_live_round_count() + this->get_blank_round_count() <= cutoff_shell_count) {
+			limits->is_truncated.store(true, std::memory_order_relaxed);
+			return this->estimate();
+		}
+	}
+
+	if (visitor) {
+		// Node::expand() stops one ply below the node it expands.
+		if (depth > 0) {
+			return visitor->visit(*this);
+		}
+	}
+	else if (std::optional<TranspositionHit> hit =
+	             current_context->get_table().get_ev(*this, cutoff_shell_count)) {
+		// Only a budgeted search accepts estimated entries.
+		if (hit->cutoff_shell_count != 0) {
+			limits->is_truncated.store(true, std::memory_order_relaxed);
+		}
+		return hit->ev;
+	}
+
+	if (this->is_dealer_turn()) {
+		return this->dealer_expectimax<MaxLives>(depth);
+	}
+	return this->player_expectimax<MaxLives>(depth);
+}
+
+// The chance node between two loads of a campaign: a uniform number of shells, a uniform split
+// into live and blank ones with at least one of each, and items for both sides up to a full table.
+// The player starts every load. The loads dealt here are scored at their end, which keeps the
+// number of positions searched bounded.
+//
+// Double or nothing deals from all kinds, hundreds of item combinations per side, which is far too
+// many loads to search. Its reloads are estimated from the lives and the items each side can
+// expect to hold when the next load starts.
+template <int MaxLives>
+float Node::reload_expectimax(int depth) {
+	count_search_stat(&SearchCounters::reload_nodes);
+	const ItemManager dealer_items = this->get_dealer_items();
+	const ItemManager player_items = this->get_player_items();
+	if (this->is_double_or_nothing()) {
+		return this->estimate() +
+		       get_expected_double_or_nothing_grant(player_items.get_item_count()) -
+		       get_expected_double_or_nothing_grant(dealer_items.get_item_count());
+	}
+	const uint64_t key = Node(false, false, false, 0, 0, MaxLives, this->get_dealer_lives(),
+	                          this->get_player_lives(), dealer_items, player_items, false, false,
+	                          true, true)
+	                         .get_key();
+	CampaignCache &campaign_cache = current_context->get_campaign_cache();
+	if (std::optional<float> ev = campaign_cache.get_ev(key)) {
 		return ev.value();
 	}
 
-	const float probability_live = static_cast<float>(this->live_round_count) /
-	                               (this->live_round_count + this->blank_round_count);
+	// The first iteration of a budgeted search cannot abort, so it stays within the current load.
+	SearchLimits *limits = current_limits;
+	if (limits && !limits->can_abort) {
+		limits->is_truncated.store(true, std::memory_order_relaxed);
+		return this->estimate();
+	}
+
+	// The loads are searched as positions of their own, also when this is a child of expand().
+	ChildVisitorScope scope(nullptr);
+	const std::vector<ItemGrant> &dealer_grants = get_item_grants()[std::min(
+	    get_items_per_load(MaxLives), MAX_HELD_ITEM_COUNT - dealer_items.get_item_count())];
+	const std::vector<ItemGrant> &player_grants = get_item_grants()[std::min(
+	    get_items_per_load(MaxLives), MAX_HELD_ITEM_COUNT - player_items.get_item_count())];
+
+	// Grants never exceed the free slots, so the items always fit.
+	auto add_grant = [](ItemManager items, const ItemGrant &grant) {
+		items.items += grant.items;
+		return items;
+	};
+
+	auto search_shell_count = [&](int shell_count) {
+		float ev = 0.0f;
+		for (int live_round_count = 1; live_round_count < shell_count; ++live_round_count) {
+			for (const ItemGrant &dealer_grant : dealer_grants) {
+				for (const ItemGrant &player_grant : player_grants) {
+					Node load(false, false, false, live_round_count,
+					          shell_count - live_round_count, MaxLives, this->get_dealer_lives(),
+					          this->get_player_lives(),
+					          add_grant(dealer_items, dealer_grant),
+					          add_grant(player_items, player_grant));
+					std::optional<float> load_ev = campaign_cache.get_ev(load.get_key());
+					if (!load_ev) {
+						load_ev = load.expectimax<MaxLives>(depth + 1);
+						if (!limits) {
+							campaign_cache.add_ev(load.get_key(), load_ev.value());
+						}
+					}
+					ev += load_ev.value() * dealer_grant.probability * player_grant.probability;
+				}
+			}
+		}
+		return ev / (shell_count - 1);
+	};
+
+	// Shell counts 2 to MAX_SHELL_COUNT, summed in order whichever thread searched them.
+	std::array<float, MAX_SHELL_COUNT - 1> shell_count_evs;
+	if (current_context->get_scheduler()) {
+		fork_join<MAX_SHELL_COUNT - 1>([&](std::size_t i) {
+			shell_count_evs[i] = search_shell_count(static_cast<int>(i) + 2);
+		});
+	}
+	else {
+		for (std::size_t i = 0; i < shell_count_evs.size(); ++i) {
+			shell_count_evs[i] = search_shell_count(static_cast<int>(i) + 2);
+		}
+	}
+	float ev = 0.0f;
+	for (float shell_count_ev : shell_count_evs) {
+		ev += shell_count_ev;
+	}
+	ev /= shell_count_evs.size();
+
+	if (!limits) {
+		campaign_cache.add_ev(key, ev);
+	}
+	return ev;
+}
+
+template <int MaxLives>
+float Node::dealer_expectimax(int depth) {
+	count_search_stat(&SearchCounters::dealer_nodes);
+
+	constexpr auto shoot_dealer_live = &Node::apply_shoot_dealer_live<MaxLives, true>;
+	constexpr auto shoot_dealer_blank = &Node::apply_shoot_dealer_blank<MaxLives, true>;
+	constexpr auto shoot_player_live = &Node::apply_shoot_player_live<MaxLives, true>;
+	constexpr auto shoot_player_blank = &Node::apply_shoot_player_blank<MaxLives, true>;
+	const float probability_live = static_cast<float>(this->get_live_round_count()) /
+	                               (this->get_live_round_count() + this->get_blank_round_count());
 	const float probability_blank = 1.0f - probability_live;
-	auto [shoot_player_blank, shoot_player_live, shoot_dealer_blank, shoot_dealer_live] =
-	    this->get_states_after_shoot();
-
-	if (this->is_dealer_turn) {
-		const float item_pickup_probability = 1.0f / this->dealer_items.get_item_count();
-		/*
-		 * The dealer AI acts as follows:
-		 * - It always knows the last round type and acts accordingly.
-		 * - If it doesn't know the currect round type, it flips a coin.
-		 * - Before shooting, it iterates through his items in the order they spawned (we assume the
-		 * order is random) and decides if he wants to use them.
-		 * Item usages:
-		 * - Beer: If its not the last round and he the known round (if known) isn't live.
-		 * - Cigarettes: If the dealer's health is not full.
-		 * - Magnifying Glass: If he doesn't already know the current round and it isn't the last
-		 * one.
-		 * - Handsaw: If the dealer knows that the current round is live and he hasn't already used
-		 * a handsaw. He also uses a handsaw if he decides to shoot the player.
-		 * - Handcuffs: If the player is not already handcuffed and it's not the last round.
-		 */
-
-		bool chose_item = false;
-		float ev_after_item_usage = 0.0f;
-
-		if (this->dealer_items.has_beer() && !this->curr_is_live && !this->is_last_round()) {
-			ev_after_item_usage += this->calc_drink_beer_ev(item_pickup_probability);
-			chose_item = true;
-		}
-		if (this->dealer_items.has_cigarette_pack() && this->dealer_lives != this->max_lives) {
-			ev_after_item_usage += this->calc_smoke_cigarette_ev(item_pickup_probability);
-			chose_item = true;
-		}
-		if (this->dealer_items.has_magnifying_glass() && !this->curr_is_live &&
-		    !this->curr_is_blank && !this->is_last_round()) {
-			ev_after_item_usage += this->calc_use_magnifying_glass_ev(item_pickup_probability);
-			chose_item = true;
-		}
-		if (this->dealer_items.has_handsaw() && !this->handsaw_applied && this->curr_is_live) {
-			ev_after_item_usage += this->calc_use_handsaw_ev(item_pickup_probability);
-			chose_item = true;
-		}
-		if (this->dealer_items.has_handcuffs() && this->handcuffs_available &&
-		    !this->handcuffs_applied && !this->is_last_round()) {
-			ev_after_item_usage += this->calc_use_handcuffs_ev(item_pickup_probability);
-			chose_item = true;
-		}
-
-		if (chose_item) {
-			tt_manager.add_node(*this, ev_after_item_usage);
-			return ev_after_item_usage;
-		}
-
-		if (this->is_last_round()) {
-			if (this->live_round_count == 1) {
-				return shoot_player_live.eval();
+	const bool should_fork = this->should_fork();
+	const ItemManager dealer_items = this->get_dealer_items();
+	const float item_pickup_probability = 1.0f / dealer_items.get_item_count();
+	/*
+	 * The dealer AI acts as follows:
+	 * - It always knows the last round type and acts accordingly.
+	 * - If it doesn't know the currect round type, it flips a coin.
+	 * - Before shooting, it iterates through his items in the order they spawned (we assume the
+	 * order is random) and decides if he wants to use them.
+	 * Item usages:
+	 * - Beer: If its not the last round and he the known round (if known) isn't live.
+	 * - Cigarettes: If the dealer's health is not full.
+	 * - Magnifying Glass: If he doesn't already know the current round and it isn't the last
+	 * one.
+	 * - Handsaw: If the dealer knows that the current round is live and he hasn't already used
+	 * a handsaw. He also uses a handsaw if he decides to shoot the player.
+	 * - Handcuffs: If the player is not already handcuffed and it's not the last round.
+	 * - Inverter: If he knows that the current round is blank.
+	 * - Expired Medicine: If his health is not full and he can afford to lose a life.
+	 * Adrenaline and the burner phone are never picked.
+	 */
+
+	// One mask of the items the dealer holds, tested per kind below.
+	const uint64_t present = dealer_items.get_presence_mask();
+	const bool uses_beer = (present & ItemManager::get_presence_bit<ItemKind::BEER>()) &&
+	                       !this->round_known_live() && !this->is_last_round();
+	const bool uses_cigarette_pack =
+	    (present & ItemManager::get_presence_bit<ItemKind::CIGARETTE_PACK>()) &&
+	    this->get_dealer_lives() != MaxLives;
+	const bool uses_magnifying_glass =
+	    (present & ItemManager::get_presence_bit<ItemKind::MAGNIFYING_GLASS>()) &&
+	    !this->round_known_live() && !this->round_known_blank() && !this->is_last_round();
+	const bool uses_handsaw = (present & ItemManager::get_presence_bit<ItemKind::HANDSAW>()) &&
+	                          !this->is_handsaw_applied() && this->round_known_live();
+	const bool uses_handcuffs =
+	    (present & ItemManager::get_presence_bit<ItemKind::HANDCUFFS>()) &&
+	    this->is_handcuffs_available() && !this->is_handcuffs_applied() && !this->is_last_round();
+	const bool uses_inverter = (present & ItemManager::get_presence_bit<ItemKind::INVERTER>()) &&
+	                           (this->round_known_blank() || this->is_only_blank_rounds());
+	const bool uses_expired_medicine =
+	    (present & ItemManager::get_presence_bit<ItemKind::EXPIRED_MEDICINE>()) &&
+	    this->get_dealer_lives() != MaxLives && !this->dealer_is_fade_charge<MaxLives>() &&
+	    this->get_dealer_lives() > 1;
+
+	if (uses_beer || uses_cigarette_pack || uses_magnifying_glass || uses_handsaw ||
+	    uses_handcuffs || uses_inverter || uses_expired_medicine) {
+		// The dealer picks one of its items at random. Unused items contribute 0, which keeps the
+		// sum identical to adding them up in order.
+		const std::array<float, 7> item_probabilities = {
+		    uses_beer ? item_pickup_probability : 0.0f,
+		    uses_cigarette_pack ? item_pickup_probability : 0.0f,
+		    uses_magnifying_glass ? item_pickup_probability : 0.0f,
+		    uses_handsaw ? item_pickup_probability : 0.0f,
+		    uses_handcuffs ? item_pickup_probability : 0.0f,
+		    uses_inverter ? item_pickup_probability : 0.0f,
+		    uses_expired_medicine ? item_pickup_probability : 0.0f,
+		};
+		std::array<float, 7> item_evs = {};
+		search_chance_outcomes<7>(should_fork, item_probabilities, item_evs, [&](std::size_t i) {
+			switch (i) {
+				case 0:
+					return this->calc_drink_beer_ev<MaxLives, true>(item_pickup_probability, depth);
+				case 1:
+					return this->calc_smoke_cigarette_ev<MaxLives, true>(item_pickup_probability,
+					                                                     depth);
+				case 2:
+					return this->calc_use_magnifying_glass_ev<MaxLives, true>(
+					    item_pickup_probability, depth);
+				case 3:
+					return this->calc_use_handsaw_ev<MaxLives, true>(item_pickup_probability,
+					                                                 depth);
+				case 4:
+					return this->calc_use_handcuffs_ev<MaxLives, true>(item_pickup_probability,
+					                                                   depth);
+				case 5:
+					return this->calc_use_inverter_ev<MaxLives, true>(item_pickup_probability,
+					                                                  depth);
+				default:
+					return this->calc_use_expired_medicine_ev<MaxLives, true>(
+					    item_pickup_probability, depth);
 			}
+		});
 
-			return shoot_dealer_blank.eval();
-		}
+		const float ev_after_item_usage = 0.0f + item_evs[0] + item_evs[1] + item_evs[2] +
+		                                  item_evs[3] + item_evs[4] + item_evs[5] + item_evs[6];
+		store_ev(*this, ev_after_item_usage);
+		return ev_after_item_usage;
+	}
 
-		if (this->curr_is_live) {
-			const float ev = shoot_player_live.expectimax();
-			tt_manager.add_node(*this, ev);
-			return ev;
+	if (this->is_last_round()) {
+		const uint64_t saved_state = this->state;
+		if (this->get_live_round_count() == 1) {
+			this->apply_shoot_player_live<MaxLives, true>();
 		}
-
-		if (this->curr_is_blank) {
-			const float ev = shoot_dealer_blank.expectimax();
-			tt_manager.add_node(*this, ev);
-			return ev;
+		else {
+			this->apply_shoot_dealer_blank<MaxLives, true>();
 		}
-
-		if (this->is_only_live_rounds()) {
-			const float ev =
-			    shoot_dealer_live.expectimax() * 0.5f + shoot_player_live.expectimax() * 0.5f;
-			tt_manager.add_node(*this, ev);
-			return ev;
+		float ev;
+		if (this->is_reload_pending()) {
+			ev = this->expectimax<MaxLives>(depth + 1);
 		}
-
-		if (this->is_only_blank_rounds()) {
-			const float ev =
-			    shoot_dealer_blank.expectimax() * 0.5f + shoot_player_blank.expectimax() * 0.5f;
-			tt_manager.add_node(*this, ev);
-			return ev;
+		else {
+			// Scored in place, without a node of its own.
+			if (ChildVisitor *visitor = current_child_visitor) {
+				visitor->visit_terminal(*this);
+			}
+			ev = this->eval();
 		}
-
-		const float ev = shoot_dealer_live.expectimax() * probability_live * 0.5f +
-		                 shoot_dealer_blank.expectimax() * probability_blank * 0.5f +
-		                 shoot_player_live.expectimax() * probability_live * 0.5f +
-		                 shoot_player_blank.expectimax() * probability_blank * 0.5f;
-		tt_manager.add_node(*this, ev);
+		this->state = saved_state;
 		return ev;
 	}
 
-	float best_ev = std::numeric_limits<float>::lowest();
+	if (this->round_known_live()) {
+		const float ev = this->search_after<MaxLives, shoot_player_live>(depth, false);
+		store_ev(*this, ev);
+		return ev;
+	}
 
-	if (this->player_items.has_beer() && !this->curr_is_blank && !this->is_only_blank_rounds()) {
-		best_ev = std::max(this->calc_drink_beer_ev(1.0f), best_ev);
+	if (this->round_known_blank()) {
+		const float ev = this->search_after<MaxLives, shoot_dealer_blank>(depth, false);
+		store_ev(*this, ev);
+		return ev;
 	}
-	if (this->player_items.has_cigarette_pack() && !this->player_is_fade_charge() &&
-	    this->player_lives != this->max_lives) {
-		best_ev = std::max(this->calc_smoke_cigarette_ev(1.0f), best_ev);
+
+	// Otherwise the dealer flips a coin for whom to shoot.
+	if (this->is_only_live_rounds()) {
+		const float ev = this->search_chance<MaxLives, shoot_dealer_live, shoot_player_live>(
+		    0.5f, 0.5f, 1.0f, depth);
+		store_ev(*this, ev);
+		return ev;
 	}
-	if (this->player_items.has_magnifying_glass() && !this->curr_is_live && !this->curr_is_blank &&
-	    !this->is_only_live_rounds() && !this->is_only_blank_rounds()) {
-		best_ev = std::max(this->calc_use_magnifying_glass_ev(1.0f), best_ev);
+
+	if (this->is_only_blank_rounds()) {
+		const float ev = this->search_chance<MaxLives, shoot_dealer_blank, shoot_player_blank>(
+		    0.5f, 0.5f, 1.0f, depth);
+		store_ev(*this, ev);
+		return ev;
 	}
-	if (this->player_items.has_handsaw() && !this->handsaw_applied &&
-	    !this->is_only_blank_rounds() && !this->curr_is_blank) {
-		best_ev = std::max(this->calc_use_handsaw_ev(1.0f), best_ev);
+
+	std::array<float, 4> shot_evs = {};
+	search_chance_outcomes<4>(
+	    should_fork,
+	    {probability_live * 0.5f, probability_blank * 0.5f, probability_live * 0.5f,
+	     probability_blank * 0.5f},
+	    shot_evs, [&](std::size_t i) {
+		    switch (i) {
+			    case 0:
+				    return this->search_after<MaxLives, shoot_dealer_live>(depth, should_fork) *
+				           probability_live * 0.5f;
+			    case 1:
+				    return this->search_after<MaxLives, shoot_dealer_blank>(depth, should_fork) *
+				           probability_blank * 0.5f;
+			    case 2:
+				    return this->search_after<MaxLives, shoot_player_live>(depth, should_fork) *
+				           probability_live * 0.5f;
+			    default:
+				    return this->search_after<MaxLives, shoot_player_blank>(depth, should_fork) *
+				           probability_blank * 0.5f;
+		    }
+	    });
+
+	const float ev = shot_evs[0] + shot_evs[1] + shot_evs[2] + shot_evs[3];
+	store_ev(*this, ev);
+	return ev;
+}
+
+// Actions the player may take. After adrenaline these are the dealer's items that could be used,
+// and nothing else.
+template <int MaxLives>
+std::array<bool, ACTION_COUNT> Node::get_player_actions(void) const {
+	const bool is_stealing = this->is_adrenaline_applied();
+	const ItemManager items = is_stealing ? this->get_dealer_items() : this->get_player_items();
+	const bool shoots_known_live = this->is_only_live_rounds() || this->round_known_live();
+	const bool shoots_known_blank =
+	    !shoots_known_live && (this->is_only_blank_rounds() || this->round_known_blank());
+
+	std::array<bool, ACTION_COUNT> is_available;
+	is_available[static_cast<int>(Action::DRINK_BEER)] =
+	    items.has<ItemKind::BEER>() && !this->round_known_blank() && !this->is_only_blank_rounds();
+	is_available[static_cast<int>(Action::SMOKE_CIGARETTE)] =
+	    items.has<ItemKind::CIGARETTE_PACK>() && !this->player_is_fade_charge<MaxLives>() &&
+	    this->get_player_lives() != MaxLives;
+	is_available[static_cast<int>(Action::USE_MAGNIFYING_GLASS)] =
+	    items.has<ItemKind::MAGNIFYING_GLASS>() && !this->round_known_live() &&
+	    !this->round_known_blank() && !this->is_only_live_rounds() && !this->is_only_blank_rounds();
+	is_available[static_cast<int>(Action::USE_HANDSAW)] =
+	    items.has<ItemKind::HANDSAW>() && !this->is_handsaw_applied() &&
+	    !this->is_only_blank_rounds() && !this->round_known_blank();
+	is_available[static_cast<int>(Action::USE_HANDCUFFS)] =
+	    items.has<ItemKind::HANDCUFFS>() && this->is_handcuffs_available() &&
+	    !this->is_handcuffs_applied() && !this->is_last_round();
+	is_available[static_cast<int>(Action::USE_INVERTER)] = items.has<ItemKind::INVERTER>();
+	is_available[static_cast<int>(Action::USE_EXPIRED_MEDICINE)] =
+	    items.has<ItemKind::EXPIRED_MEDICINE>() && !this->player_is_fade_charge<MaxLives>() &&
+	    this->get_player_lives() != MaxLives;
+	// Only with two rounds left does the phone tell something about the current one.
+	is_available[static_cast<int>(Action::USE_BURNER_PHONE)] =
+	    items.has<ItemKind::BURNER_PHONE>() && this->get_live_round_count() == 1 &&
+	    this->get_blank_round_count() == 1 && !this->round_known_live() &&
+	    !this->round_known_blank();
+	is_available[static_cast<int>(Action::USE_ADRENALINE)] = false;
+	is_available[static_cast<int>(Action::SHOOT_DEALER)] = !is_stealing && !shoots_known_blank;
+	is_available[static_cast<int>(Action::SHOOT_PLAYER)] = !is_stealing && !shoots_known_live;
+
+	// Adrenaline is only worth using when there is something to take.
+	if (!is_stealing && items.has<ItemKind::ADRENALINE>()) {
+		Node stealing = *this;
+		stealing.set_field<ADRENALINE_APPLIED_SHIFT, 1>(true);
+		const std::array<bool, ACTION_COUNT> steals = stealing.get_player_actions<MaxLives>();
+		is_available[static_cast<int>(Action::USE_ADRENALINE)] =
+		    std::find(steals.begin(), steals.end(), true) != steals.end();
 	}
-	if (this->player_items.has_handcuffs() && this->handcuffs_available &&
-	    !this->handcuffs_applied && !this->is_last_round()) {
-		best_ev = std::max(this->calc_use_handcuffs_ev(1.0f), best_ev);
+	return is_available;
+}
+
+template <int MaxLives>
+float Node::search_player_action(Action action, int depth, bool should_fork) {
+	constexpr auto shoot_dealer_live = &Node::apply_shoot_dealer_live<MaxLives, false>;
+	constexpr auto shoot_dealer_blank = &Node::apply_shoot_dealer_blank<MaxLives, false>;
+	constexpr auto shoot_player_live = &Node::apply_shoot_player_live<MaxLives, false>;
+	constexpr auto shoot_player_blank = &Node::apply_shoot_player_blank<MaxLives, false>;
+
+	switch (action) {
+		case Action::DRINK_BEER:
+			return this->calc_drink_beer_ev<MaxLives, false>(1.0f, depth);
+		case Action::SMOKE_CIGARETTE:
+			return this->calc_smoke_cigarette_ev<MaxLives, false>(1.0f, depth);
+		case Action::USE_MAGNIFYING_GLASS:
+			return this->calc_use_magnifying_glass_ev<MaxLives, false>(1.0f, depth);
+		case Action::USE_HANDSAW:
+			return this->calc_use_handsaw_ev<MaxLives, false>(1.0f, depth);
+		case Action::USE_HANDCUFFS:
+			return this->calc_use_handcuffs_ev<MaxLives, false>(1.0f, depth);
+		case Action::USE_ADRENALINE:
+			return this->calc_use_adrenaline_ev<MaxLives, false>(1.0f, depth);
+		case Action::USE_INVERTER:
+			return this->calc_use_inverter_ev<MaxLives, false>(1.0f, depth);
+		case Action::USE_EXPIRED_MEDICINE:
+			return this->calc_use_expired_medicine_ev<MaxLives, false>(1.0f, depth);
+		case Action::USE_BURNER_PHONE:
+			return this->calc_use_burner_phone_ev<MaxLives, false>(1.0f, depth);
+		default:
+			break;
 	}
 
-	if (this->is_only_live_rounds() || this->curr_is_live) {
-		best_ev = std::max(shoot_dealer_live.expectimax(), best_ev);
+	const float probability_live = static_cast<float>(this->get_live_round_count()) /
+	                               (this->get_live_round_count() + this->get_blank_round_count());
+	const float probability_blank = 1.0f - probability_live;
+	if (action == Action::SHOOT_DEALER) {
+		if (this->is_only_live_rounds() || this->round_known_live()) {
+			return this->search_after<MaxLives, shoot_dealer_live>(depth, should_fork);
+		}
+		return this->search_chance<MaxLives, shoot_dealer_live, shoot_dealer_blank>(
+		    probability_live, probability_blank, 1.0f, depth);
 	}
-	else if (this->is_only_blank_rounds() || this->curr_is_blank) {
-		best_ev = std::max(shoot_player_blank.expectimax(), best_ev);
+	if (this->is_only_blank_rounds() || this->round_known_blank()) {
+		return this->search_after<MaxLives, shoot_player_blank>(depth, should_fork);
+	}
+	return this->search_chance<MaxLives, shoot_player_live, shoot_player_blank>(
+	    probability_live, probability_blank, 1.0f, depth);
+}
+
+template <int MaxLives>
+float Node::player_expectimax(int depth) {
+	count_search_stat(&SearchCounters::player_nodes);
+
+	const bool should_fork = this->should_fork();
+	const std::array<bool, ACTION_COUNT> is_available = this->get_player_actions<MaxLives>();
+	auto search_action = [&](Action action) {
+		return this->search_player_action<MaxLives>(action, depth, should_fork);
+	};
+
+	// Skipped actions stay at lowest(), which never wins the max below.
+	float best_ev = std::numeric_limits<float>::lowest();
+	if (should_fork) {
+		std::array<float, ACTION_COUNT> action_evs;
+		action_evs.fill(std::numeric_limits<float>::lowest());
+		fork_join<ACTION_COUNT>([&](std::size_t i) {
+			if (is_available[i]) {
+				action_evs[i] = search_action(static_cast<Action>(i));
+			}
+		});
+		best_ev = *std::max_element(action_evs.begin(), action_evs.end());
 	}
 	else {
-		best_ev = std::max(shoot_dealer_live.expectimax() * probability_live +
-		                       shoot_dealer_blank.expectimax() * probability_blank,
-		                   best_ev);
-		best_ev = std::max(shoot_player_live.expectimax() * probability_live +
-		                       shoot_player_blank.expectimax() * probability_blank,
-		                   best_ev);
+		for (int i = 0; i < ACTION_COUNT; ++i) {
+			if (is_available[i]) {
+				best_ev = std::max(search_action(static_cast<Action>(i)), best_ev);
+			}
+		}
 	}
 
-	tt_manager.add_node(*this, best_ev);
+	store_ev(*this, best_ev);
 	return best_ev;
 }
 
-bool Node::round_known_live(void) const { return this->curr_is_live; }
+Node Node::from_key(uint64_t key) {
+	assert((key >> DEALER_ITEMS_SHIFT & CLASSIC_RANK_MASK) < ClassicInventoryTable::SIZE &&
+	       (key >> PLAYER_ITEMS_SHIFT & CLASSIC_RANK_MASK) < ClassicInventoryTable::SIZE);
+	Node node;
+	node.state = key;
+	return node;
+}
 
-bool Node::round_known_blank(void) const { return this->curr_is_blank; }
+bool Node::is_valid_key(uint64_t key) {
+	auto is_valid_items = [](uint64_t bits) {
+		return (bits & CLASSIC_RANK_MASK) < ClassicInventoryTable::SIZE &&
+		       make_items(bits).can_be_held();
+	};
+	Node node;
+	node.state = key;
+	const int max_lives = node.get_max_lives();
+	const int live_round_count = node.get_live_round_count();
+	const int blank_round_count = node.get_blank_round_count();
+	return max_lives != 0 && node.get_dealer_lives() <= max_lives &&
+	       node.get_player_lives() <= max_lives && live_round_count + blank_round_count <= 8 &&
+	       !(node.round_known_live() && node.round_known_blank()) &&
+	       !(node.round_known_live() && live_round_count == 0) &&
+	       !(node.round_known_blank() && blank_round_count == 0) &&
+	       is_valid_items(node.get_field<DEALER_ITEMS_SHIFT, ITEMS_WIDTH>()) &&
+	       is_valid_items(node.get_field<PLAYER_ITEMS_SHIFT, ITEMS_WIDTH>());
+}
 
-ItemManager Node::get_dealer_items(void) const { return this->dealer_items; }
+uint8_t Node::get_subtree_depth(void) const {
+	return this->get_live_round_count() + this->get_blank_round_count() +
+	       this->get_dealer_item_count() + this->get_player_item_count();
+}
 
-ItemManager Node::get_player_items(void) const { return this->player_items; }
+bool Node::should_fork(void) const {
+	const SearchContext *context = current_context;
+	return context->get_scheduler() && !current_child_visitor &&
+	       this->get_subtree_depth() >= context->get_parallel_cutoff();
+}
 
-bool Node::is_player_turn(void) const { return !this->is_dealer_turn; }
+float Node::get_ev(SearchContext &context) const {
+	if (this->is_player_turn() && !this->is_terminal()) {
+		return this->get_best_action(context).second;
+	}
 
-int Node::get_live_round_count(void) { return this->live_round_count; }
+	SearchContextScope scope(context);
+	context.get_table().new_search();
+	Node root = *this;
+	return dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                       [&root](auto max_lives, auto) { return root.expectimax<max_lives>(0); });
+}
 
-int Node::get_blank_round_count(void) { return this->blank_round_count; }
+float Node::expand(ChildVisitor &visitor, SearchContext &context) const {
+	SearchContextScope context_scope(context);
+	ChildVisitorScope scope(&visitor);
+	Node root = *this;
+	return dispatch_kernel(this->get_max_lives(), this->is_dealer_turn(),
+	                       [&root](auto max_lives, auto) { return root.expectimax<max_lives>(0); });
+}
 
-int Node::get_dealer_lives(void) { return this->dealer_lives; }
+std::pair<Action, float> Node::get_best_action(ChildVisitor &visitor,
+                                               SearchContext &context) const {
+	SearchContextScope context_scope(context);
+	ChildVisitorScope scope(&visitor);
+	return dispatch_kernel(this->get_max_lives(), false, [this](auto max_lives, auto) {
+		return this->search_root<max_lives>();
+	});
+}
 
-int Node::get_player_lives(void) { return this->player_lives; }
+std::pair<Action, float> Node::get_best_action(SearchContext &context) const {
+	if (std::optional<std::pair<Action, float>> solved = tablebase.probe(*this)) {
+		return solved.value();
+	}
 
-std::pair<Action, float> Node::get_best_action(void) const {
-	tt_manager.clear_table();
-	Action best_action = Action::SHOOT_DEALER;
+	SearchContextScope scope(context);
+	// The stored EVs are exact for the whole remaining load, so entries from the previous move stay
+	// valid. A new generation only marks them as the first to go when the table fills up.
+	context.get_table().new_search();
+	return dispatch_kernel(this->get_max_lives(), false, [this](auto max_lives, auto) {
+		return this->search_root<max_lives>();
+	});
+}
 
-	float shoot_player_ev = std::numeric_limits<float>::lowest();
-	float shoot_dealer_ev = std::numeric_limits<float>::lowest();
-	float best_item_ev = std::numeric_limits<float>::lowest();
+SearchResult Node::get_best_action(const SearchBudget &budget, SearchContext &context) const {
+	const int shell_count = this->get_live_round_count() + this->get_blank_round_count();
+	if (budget.is_unlimited()) {
+		const std::pair<Action, float> best = this->get_best_action(context);
+		return SearchResult{best.first, best.second, !this->is_reload_estimated(), shell_count};
+	}
+	if (std::optional<std::pair<Action, float>> solved = tablebase.probe(*this)) {
+		return SearchResult{solved->first, solved->second, true, shell_count};
+	}
 
-	const float probability_live = static_cast<float>(this->live_round_count) /
-	                               (this->live_round_count + this->blank_round_count);
-	const float probability_blank = 1.0f - probability_live;
-	auto [shoot_player_blank, shoot_player_live, shoot_dealer_blank, shoot_dealer_live] =
-	    this->get_states_after_shoot();
+	SearchLimits limits;
+	limits.has_deadline = budget.time.count() > 0;
+	limits.deadline = std::chrono::steady_clock::now() + budget.time;
+	limits.node_budget = budget.nodes;
+
+	// Iterative deepening on the shells left: every iteration searches one more shell before
+	// estimating, and reuses the deeper entries of the previous one from the transposition table.
+	// Only a completed iteration replaces the answer.
+	SearchContextScope scope(context);
+	context.get_table().new_search();
+	SearchResult result{Action::SHOOT_DEALER, 0.0f, false, 0};
+	for (int cutoff_shell_count = shell_count - 1; cutoff_shell_count >= 0; --cutoff_shell_count) {
+		limits.cutoff_shell_count = cutoff_shell_count;
+		limits.is_truncated.store(false, std::memory_order_relaxed);
+
+		std::pair<Action, float> best;
+		{
+			SearchLimitsScope scope(&limits);
+			best = dispatch_kernel(this->get_max_lives(), false, [this](auto max_lives, auto) {
+				return this->search_root<max_lives>();
+			});
+		}
+		if (limits.is_aborted.load(std::memory_order_relaxed)) {
+			break;
+		}
 
-	if (this->player_items.has_beer() && !this->curr_is_blank && !this->is_only_blank_rounds()) {
-		const float ev = this->calc_drink_beer_ev(1.0f);
-		if (ev > best_item_ev) {
-			best_item_ev = ev;
-			best_action = Action::DRINK_BEER;
+		if (!limits.is_truncated.load(std::memory_order_relaxed)) {
+			result =
+			    SearchResult{best.first, best.second, !this->is_reload_estimated(), shell_count};
+			break;
 		}
+		result = SearchResult{best.first, best.second, false, shell_count - cutoff_shell_count};
+		limits.can_abort = true;
 	}
-	if (this->player_items.has_cigarette_pack() && !this->player_is_fade_charge() &&
-	    this->player_lives != this->max_lives) {
-		const float ev = this->calc_smoke_cigarette_ev(1.0f);
-		if (ev > best_item_ev) {
-			best_item_ev = ev;
-			best_action = Action::SMOKE_CIGARETTE;
+	return result;
+}
+
+template <int MaxLives>
+std::pair<Action, float> Node::search_root(void) const {
+	// Every root action is an independent subtree, so they are collected first and may be evaluated
+	// concurrently, each on its own copy of the root. The decision below only depends on the order
+	// they were collected in: items in enum order, then the shots.
+	const std::array<bool, ACTION_COUNT> is_available = this->get_player_actions<MaxLives>();
+	std::vector<Action> candidates;
+	for (int i = 0; i < ACTION_COUNT; ++i) {
+		const Action action = static_cast<Action>(i);
+		if (is_available[i] && action != Action::SHOOT_DEALER && action != Action::SHOOT_PLAYER) {
+			candidates.push_back(action);
 		}
 	}
-	if (this->player_items.has_magnifying_glass() && !this->curr_is_live && !this->curr_is_blank &&
-	    !this->is_only_live_rounds() && !this->is_only_blank_rounds()) {
-		const float ev = this->calc_use_magnifying_glass_ev(1.0f);
-		if (ev > best_item_ev) {
-			best_item_ev = ev;
-			best_action = Action::USE_MAGNIFYING_GLASS;
+	for (Action action : {Action::SHOOT_DEALER, Action::SHOOT_PLAYER}) {
+		if (is_available[static_cast<int>(action)]) {
+			candidates.push_back(action);
 		}
 	}
-	if (this->player_items.has_handsaw() && !this->handsaw_applied &&
-	    !this->is_only_blank_rounds() && !this->curr_is_blank) {
-		const float ev = this->calc_use_handsaw_ev(1.0f);
-		if (ev > best_item_ev) {
-			best_item_ev = ev;
-			best_action = Action::USE_HANDSAW;
+
+	std::vector<float> candidate_evs(candidates.size());
+	auto evaluate_candidate = [this, &candidate_evs, &candidates](std::size_t i) {
+		Node root = *this;
+		if constexpr (SEARCH_STATS_ENABLED) {
+			const auto start_time = std::chrono::steady_clock::now();
+			candidate_evs[i] = root.search_player_action<MaxLives>(candidates[i], 0, false);
+			count_root_action_time(candidates[i],
+			                       std::chrono::duration_cast<std::chrono::nanoseconds>(
+			                           std::chrono::steady_clock::now() - start_time)
+			                           .count());
+		}
+		else {
+			candidate_evs[i] = root.search_player_action<MaxLives>(candidates[i], 0, false);
 		}
+	};
+
+	SearchContext *context = current_context;
+	if (context->get_scheduler() && !current_child_visitor) {
+		SearchLimits *limits = current_limits;
+		TaskGroup group(*context->get_scheduler());
+		for (std::size_t i = 0; i < candidates.size(); ++i) {
+			group.spawn([&evaluate_candidate, context, limits, i] {
+				SearchContextScope context_scope(*context);
+				SearchLimitsScope limits_scope(limits);
+				evaluate_candidate(i);
+			});
+		}
+		group.wait();
 	}
-	if (this->player_items.has_handcuffs() && this->handcuffs_available &&
-	    !this->handcuffs_applied && !this->is_last_round()) {
-		const float ev = this->calc_use_handcuffs_ev(1.0f);
-		if (ev > best_item_ev) {
-			best_item_ev = ev;
-			best_action = Action::USE_HANDCUFFS;
+	else {
+		for (std::size_t i = 0; i < candidates.size(); ++i) {
+			evaluate_candidate(i);
 		}
 	}
 
-	if (this->is_only_live_rounds() || this->curr_is_live) {
-		shoot_dealer_ev = shoot_dealer_live.expectimax();
-	}
-	else if (this->is_only_blank_rounds() || this->curr_is_blank) {
-		shoot_player_ev = shoot_player_blank.expectimax();
-	}
-	else {
-		shoot_dealer_ev = shoot_dealer_live.expectimax() * probability_live +
-		                  shoot_dealer_blank.expectimax() * probability_blank;
-		shoot_player_ev = shoot_player_live.expectimax() * probability_live +
-		                  shoot_player_blank.expectimax() * probability_blank;
+	Action best_action = Action::SHOOT_DEALER;
+	float shoot_player_ev = std::numeric_limits<float>::lowest();
+	float shoot_dealer_ev = std::numeric_limits<float>::lowest();
+	float best_item_ev = std::numeric_limits<float>::lowest();
+
+	for (std::size_t i = 0; i < candidates.size(); ++i) {
+		const Action action = candidates[i];
+		const float ev = candidate_evs[i];
+
+		if (action == Action::SHOOT_DEALER) {
+			shoot_dealer_ev = ev;
+		}
+		else if (action == Action::SHOOT_PLAYER) {
+			shoot_player_ev = ev;
+		}
+		else if (ev > best_item_ev) {
+			best_item_ev = ev;
+			best_action = action;
+		}
 	}
 
 	if (shoot_dealer_ev >= shoot_player_ev && shoot_dealer_ev >= best_item_ev) {
@@ -1,5 +1,9 @@
 #ifndef EXPECTIMAX_HPP
 #define EXPECTIMAX_HPP
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <utility>
@@ -14,17 +18,99 @@ enum class Action {
 	USE_MAGNIFYING_GLASS,
 	USE_HANDSAW,
 	USE_HANDCUFFS,
+	USE_ADRENALINE,
+	USE_INVERTER,
+	USE_EXPIRED_MEDICINE,
+	USE_BURNER_PHONE,
 };
 
+constexpr int ACTION_COUNT = 11;
+
+// Names of the actions in enum order, as in the batch format.
+constexpr const char *ACTION_NAMES[ACTION_COUNT] = {
+    "shoot_dealer", "shoot_player",  "drink_beer",     "smoke_cigarette", "use_magnifying_glass",
+    "use_handsaw",  "use_handcuffs", "use_adrenaline", "use_inverter",    "use_expired_medicine",
+    "use_burner_phone"};
+
+constexpr const char *get_action_name(Action action) {
+	return ACTION_NAMES[static_cast<int>(action)];
+}
+
+// Subtrees with at least this many shells and items left are split into parallel tasks.
+constexpr int DEFAULT_PARALLEL_CUTOFF = 10;
+
+// Limits of an anytime search, zero meaning no limit. The search always completes a search one
+// shell deep before it checks them, so it can overrun a very small budget.
+struct SearchBudget {
+	std::chrono::milliseconds time{0};
+	uint64_t nodes = 0;
+
+	bool is_unlimited(void) const { return this->time.count() == 0 && this->nodes == 0; }
+};
+
+// Double or nothing positions can hold twice as many items as the last round of normal mode, and
+// some take seconds to solve exactly. Unless told otherwise, the tools search them with this
+// budget, which keeps a query within a second.
+constexpr std::chrono::milliseconds DOUBLE_OR_NOTHING_DEFAULT_MOVETIME{900};
+
+struct SearchResult {
+	Action action;
+	float ev;
+	// Whether the EV is exact. Otherwise positions past the horizon or the next load of double or
+	// nothing were estimated.
+	bool is_exact;
+	// Number of shells searched before estimating, all of them if exact.
+	int shell_horizon;
+};
+
+class Node;
+class SearchContext;
+
+// The context of searches that are not given one, see src/search_context.hpp.
+SearchContext &get_default_search_context(void);
+
+// Takes the place of the search below the children of a node, see Node::expand().
+class ChildVisitor {
+   public:
+	virtual ~ChildVisitor() = default;
+	// Returns the EV the search uses for child, which is never terminal.
+	virtual float visit(const Node &child) = 0;
+	// Called for every terminal child instead, which the search scores itself.
+	virtual void visit_terminal(const Node &child) { (void)child; }
+};
+
+// The whole state lives in a single 64-bit word, which is its identity: two nodes are equal exactly
+// when their words are. Its canonical form is the transposition table key.
 class Node final {
    public:
 	explicit Node(bool is_dealer_turn, bool curr_is_live, bool curr_is_blank,
 	              uint8_t live_round_count, uint8_t blank_round_count, uint8_t max_lives,
 	              uint8_t dealer_lives, uint8_t player_lives, ItemManager dealer_items,
-	              ItemManager player_items);
+	              ItemManager player_items, bool handsaw_applied = false,
+	              bool handcuffs_applied = false, bool handcuffs_available = true,
+	              bool is_reload_pending = false, bool is_double_or_nothing = false);
 
-	std::pair<Action, float> get_best_action(void) const;
+	// The searches run on the caches and threads of context.
+	std::pair<Action, float> get_best_action(
+	    SearchContext &context = get_default_search_context()) const;
+	// Best action found within the budget, the exact one if the search finishes in time.
+	SearchResult get_best_action(const SearchBudget &budget,
+	                             SearchContext &context = get_default_search_context()) const;
+	float get_ev(SearchContext &context = get_default_search_context()) const;
+	// Searches a single ply: every child that is not terminal goes to visitor instead of being
+	// searched, and the EV it returns is used in its place. The transposition table is neither read
+	// nor written, and nothing is split into parallel tasks. Only the next load of a campaign is
+	// searched on context.
+	float expand(ChildVisitor &visitor,
+	             SearchContext &context = get_default_search_context()) const;
+	std::pair<Action, float> get_best_action(
+	    ChildVisitor &visitor, SearchContext &context = get_default_search_context()) const;
 	bool is_terminal(void) const;
+	// Whether the side to move gains from a cigarette pack: it is below full health, and the player
+	// is not on the fade charge of the last round.
+	bool can_smoke_cigarette(void) const;
+	// The live and blank variants name the type the current round is counted as, which an
+	// inverted round does not hit as.
 	void apply_shoot_dealer_live(void);
 	void apply_shoot_dealer_blank(void);
 	void apply_shoot_player_live(void);
@@ -35,52 +121,319 @@ class Node final {
 	void apply_magnify_live(void);
 	void apply_magnify_blank(void);
 	void apply_use_handsaw(void);
-    void apply_use_handcuffs(void);
-    void dealer_remove_magnifying_glass(void);
+	void apply_use_handcuffs(void);
+	// After adrenaline the next item action of the side to move uses an item of the other side.
+	void apply_use_adrenaline(void);
+	void apply_use_inverter(void);
+	void apply_expired_medicine_heal(void);
+	void apply_expired_medicine_damage(void);
+	// The burner phone tells the type of the other shell when two are left, which gives the
+	// current one away. These apply that, named after the current round.
+	void apply_burner_phone_live(void);
+	void apply_burner_phone_blank(void);
+	void dealer_remove_magnifying_glass(void);
+	// The dealer used its burner phone. What it saw is not modeled.
+	void dealer_remove_burner_phone(void);
 	bool is_only_live_rounds(void) const;
 	bool is_only_blank_rounds(void) const;
-	bool round_known_live(void) const;
-	bool round_known_blank(void) const;
-	bool is_player_turn(void) const;
-	ItemManager get_dealer_items(void) const;
-	ItemManager get_player_items(void) const;
-	int get_live_round_count(void);
-	int get_blank_round_count(void);
-	int get_dealer_lives(void);
-	int get_player_lives(void);
-
-	bool operator==(const Node &other) const;
+
+	constexpr bool round_known_live(void) const { return this->get_field<CURR_IS_LIVE_SHIFT, 1>(); }
+	constexpr bool round_known_blank(void) const {
+		return this->get_field<CURR_IS_BLANK_SHIFT, 1>();
+	}
+	constexpr bool is_dealer_turn(void) const { return this->get_field<DEALER_TURN_SHIFT, 1>(); }
+	constexpr bool is_player_turn(void) const { return !this->is_dealer_turn(); }
+	constexpr bool is_handsaw_applied(void) const {
+		return this->get_field<HANDSAW_APPLIED_SHIFT, 1>();
+	}
+	constexpr bool is_handcuffs_applied(void) const {
+		return this->get_field<HANDCUFFS_APPLIED_SHIFT, 1>();
+	}
+	constexpr bool is_handcuffs_available(void) const {
+		return this->get_field<HANDCUFFS_AVAILABLE_SHIFT, 1>();
+	}
+	// Campaign mode: once the shotgun is empty and both sides live, the game goes on with a new
+	// load instead of being scored. That load is scored when it runs out, so the search looks one
+	// load ahead.
+	constexpr bool is_reload_pending(void) const {
+		return this->get_field<RELOAD_PENDING_SHIFT, 1>();
+	}
+	// Double or nothing: the next load deals 1 to DOUBLE_OR_NOTHING_MAX_ITEMS_PER_LOAD items of all
+	// kinds instead of the items of the round. Only matters with a reload pending.
+	constexpr bool is_double_or_nothing(void) const {
+		return this->get_field<DOUBLE_OR_NOTHING_SHIFT, 1>();
+	}
+	// The next load is estimated instead of searched, so no EV of this position is exact.
+	constexpr bool is_reload_estimated(void) const {
+		return this->is_reload_pending() && this->is_double_or_nothing();
+	}
+	// The current round was inverted while its type was unknown: it hits as the other type than
+	// the one it is counted as. A known round is inverted by moving it to the other count instead.
+	constexpr bool is_round_inverted(void) const {
+		return this->get_field<ROUND_INVERTED_SHIFT, 1>();
+	}
+	constexpr bool is_adrenaline_applied(void) const {
+		return this->get_field<ADRENALINE_APPLIED_SHIFT, 1>();
+	}
+	constexpr ItemManager get_dealer_items(void) const {
+		return make_items(this->get_field<DEALER_ITEMS_SHIFT, ITEMS_WIDTH>());
+	}
+	constexpr ItemManager get_player_items(void) const {
+		return make_items(this->get_field<PLAYER_ITEMS_SHIFT, ITEMS_WIDTH>());
+	}
+	constexpr int get_live_round_count(void) const {
+		return this->get_field<LIVE_ROUND_COUNT_SHIFT, SHELL_COUNT_WIDTH>();
+	}
+	constexpr int get_blank_round_count(void) const {
+		return this->get_field<BLANK_ROUND_COUNT_SHIFT, SHELL_COUNT_WIDTH>();
+	}
+	constexpr int get_max_lives(void) const {
+		return this->get_field<MAX_LIVES_SHIFT, MAX_LIVES_WIDTH>() * 2;
+	}
+	constexpr int get_dealer_lives(void) const {
+		return this->get_field<DEALER_LIVES_SHIFT, LIVES_WIDTH>();
+	}
+	constexpr int get_player_lives(void) const {
+		return this->get_field<PLAYER_LIVES_SHIFT, LIVES_WIDTH>();
+	}
+
+	// The number of items a side holds, counted without spreading them into an ItemManager.
+	constexpr int get_dealer_item_count(void) const {
+		return get_item_count(this->get_field<DEALER_ITEMS_SHIFT, ITEMS_WIDTH>());
+	}
+	constexpr int get_player_item_count(void) const {
+		return get_item_count(this->get_field<PLAYER_ITEMS_SHIFT, ITEMS_WIDTH>());
+	}
+
+	uint8_t get_subtree_depth(void) const;
+	constexpr uint64_t get_key(void) const { return this->state; }
+	// Key of the state the transposition table files this one under. States the search treats
+	// alike share it:
+	// - On the player's turn a known round in a load of one shell type tells nothing new. The
+	//   dealer acts on what it knows, so its turns keep the flags.
+	// - Handcuffs availability only matters while someone holds handcuffs.
+	constexpr uint64_t get_canonical_key(void) const {
+		uint64_t key = this->state;
+		if (this->is_player_turn() &&
+		    (this->get_live_round_count() == 0 || this->get_blank_round_count() == 0)) {
+			key &= ~(field_mask<CURR_IS_LIVE_SHIFT, 1>() | field_mask<CURR_IS_BLANK_SHIFT, 1>());
+		}
+		if (!this->get_dealer_items().has<ItemKind::HANDCUFFS>() &&
+		    !this->get_player_items().has<ItemKind::HANDCUFFS>()) {
+			key |= field_mask<HANDCUFFS_AVAILABLE_SHIFT, 1>();
+		}
+		return key;
+	}
+	static Node from_key(uint64_t key);
+	// Whether key is a state word the constructor and the apply functions can produce, so that a
+	// word from outside the library is safe to pass to from_key() and search.
+	static bool is_valid_key(uint64_t key);
+
+	constexpr bool operator==(const Node &other) const { return this->state == other.state; }
 
    private:
-	float expectimax(void) const;
+	// LSB
+	// 18-0: dealer items
+	// 37-19: player items
+	// 41-38: live round count
+	// 45-42: blank round count
+	// 47-46: max lives / 2
+	// 50-48: dealer lives
+	// 53-51: player lives
+	// 54: dealer's turn
+	// 55: current round is live
+	// 56: current round is blank
+	// 57: handsaw applied
+	// 58: handcuffs applied
+	// 59: handcuffs available
+	// 60: reload pending
+	// 61: current round inverted
+	// 62: adrenaline applied
+	// 63: double or nothing
+	// MSB
+	//
+	// The items of a side are the ClassicInventoryTable rank of its classic kinds, followed by two
+	// bits per later kind. make_items() turns them into ItemManager nibbles.
+	static constexpr int CLASSIC_RANK_WIDTH = 11;
+	static constexpr int LATER_ITEM_FIELD_WIDTH = 2;
+	static constexpr int ITEMS_WIDTH =
+	    CLASSIC_RANK_WIDTH + (ITEM_KIND_COUNT - CLASSIC_ITEM_KIND_COUNT) * LATER_ITEM_FIELD_WIDTH;
+	static constexpr int SHELL_COUNT_WIDTH = 4;
+	static constexpr int MAX_LIVES_WIDTH = 2;
+	static constexpr int LIVES_WIDTH = 3;
+	static constexpr int DEALER_ITEMS_SHIFT = 0;
+	static constexpr int PLAYER_ITEMS_SHIFT = DEALER_ITEMS_SHIFT + ITEMS_WIDTH;
+	static constexpr int LIVE_ROUND_COUNT_SHIFT = PLAYER_ITEMS_SHIFT + ITEMS_WIDTH;
+	static constexpr int BLANK_ROUND_COUNT_SHIFT = LIVE_ROUND_COUNT_SHIFT + SHELL_COUNT_WIDTH;
+	static constexpr int MAX_LIVES_SHIFT = BLANK_ROUND_COUNT_SHIFT + SHELL_COUNT_WIDTH;
+	static constexpr int DEALER_LIVES_SHIFT = MAX_LIVES_SHIFT + MAX_LIVES_WIDTH;
+	static constexpr int PLAYER_LIVES_SHIFT = DEALER_LIVES_SHIFT + LIVES_WIDTH;
+	static constexpr int DEALER_TURN_SHIFT = PLAYER_LIVES_SHIFT + LIVES_WIDTH;
+	static constexpr int CURR_IS_LIVE_SHIFT = DEALER_TURN_SHIFT + 1;
+	static constexpr int CURR_IS_BLANK_SHIFT = CURR_IS_LIVE_SHIFT + 1;
+	static constexpr int HANDSAW_APPLIED_SHIFT = CURR_IS_BLANK_SHIFT + 1;
+	static constexpr int HANDCUFFS_APPLIED_SHIFT = HANDSAW_APPLIED_SHIFT + 1;
+	static constexpr int HANDCUFFS_AVAILABLE_SHIFT = HANDCUFFS_APPLIED_SHIFT + 1;
+	static constexpr int RELOAD_PENDING_SHIFT = HANDCUFFS_AVAILABLE_SHIFT + 1;
+	static constexpr int ROUND_INVERTED_SHIFT = RELOAD_PENDING_SHIFT + 1;
+	static constexpr int ADRENALINE_APPLIED_SHIFT = ROUND_INVERTED_SHIFT + 1;
+	static constexpr int DOUBLE_OR_NOTHING_SHIFT = ADRENALINE_APPLIED_SHIFT + 1;
+
+	// Keeps the layout documented above honest.
+	static_assert((1 << CLASSIC_RANK_WIDTH) >= ClassicInventoryTable::SIZE,
+	              "a rank field holds every classic inventory");
+	static_assert((1 << LATER_ITEM_FIELD_WIDTH) > MAX_LATER_ITEM_KIND_COUNT,
+	              "a field holds every count");
+	static_assert((1 << SHELL_COUNT_WIDTH) > 8, "a load holds up to 8 shells of one type");
+	static_assert((1 << MAX_LIVES_WIDTH) > 6 / 2, "the last round starts with 6 lives");
+	static_assert((1 << LIVES_WIDTH) > 6, "the last round starts with 6 lives");
+	static_assert(LIVE_ROUND_COUNT_SHIFT == 38 && DEALER_TURN_SHIFT == 54 &&
+	                  ADRENALINE_APPLIED_SHIFT == 62,
+	              "the state word layout changed");
+	static_assert(DOUBLE_OR_NOTHING_SHIFT < 64, "the state must fit in one word");
+
+	template <int Shift, int Width>
+	static constexpr uint64_t field_mask(void) {
+		return ((uint64_t{1} << Width) - 1) << Shift;
+	}
+
+	template <int Shift, int Width>
+	constexpr uint64_t get_field(void) const {
+		return (this->state & field_mask<Shift, Width>()) >> Shift;
+	}
+
+	template <int Shift, int Width>
+	constexpr void set_field(uint64_t value) {
+		this->state = (this->state & ~field_mask<Shift, Width>()) |
+		              (value << Shift & field_mask<Shift, Width>());
+	}
+
+	// Looks up the classic kinds and spreads the two bit fields of the later ones into nibbles.
+	static constexpr ItemManager make_items(uint64_t bits) {
+		uint64_t later_bits = bits >> CLASSIC_RANK_WIDTH;
+		later_bits = (later_bits | later_bits << 4) & 0x0F0Fu;
+		later_bits = (later_bits | later_bits << 2) & 0x3333u;
+		ItemManager items;
+		items.items = CLASSIC_INVENTORY_TABLE.items[bits & CLASSIC_RANK_MASK] |
+		              later_bits << (CLASSIC_ITEM_KIND_COUNT * ITEM_KIND_BITS);
+		return items;
+	}
+	// Adds the two bit fields of the later kinds in pairs, then the pairs.
+	static constexpr int get_item_count(uint64_t bits) {
+		const uint64_t later_bits = bits >> CLASSIC_RANK_WIDTH;
+		const uint64_t pair_sums = (later_bits & 0x33u) + (later_bits >> 2 & 0x33u);
+		return CLASSIC_INVENTORY_TABLE.counts[bits & CLASSIC_RANK_MASK] +
+		       static_cast<int>((pair_sums & 0xFu) + (pair_sums >> 4));
+	}
+	static constexpr uint64_t get_item_bits(ItemManager items) {
+		assert(items.can_be_held());
+		uint64_t later_bits = items.items >> (CLASSIC_ITEM_KIND_COUNT * ITEM_KIND_BITS);
+		later_bits = (later_bits | later_bits >> 2) & 0x0F0Fu;
+		later_bits = (later_bits | later_bits >> 4) & 0x00FFu;
+		return static_cast<uint64_t>(CLASSIC_INVENTORY_TABLE.get_rank(items.items)) |
+		       later_bits << CLASSIC_RANK_WIDTH;
+	}
+	static constexpr uint64_t CLASSIC_RANK_MASK = (uint64_t{1} << CLASSIC_RANK_WIDTH) - 1;
+
+	constexpr Node(void) = default;
+
+	// The search is specialized for the life tier, which never changes within a solve, and for the
+	// side to move. The public entry points pick the specialization once at the root.
+	//
+	// It makes and unmakes moves on a single node instead of copying it for every child, so these
+	// are not const. The node is back in its original state when they return.
+	template <int MaxLives>
+	std::pair<Action, float> search_root(void) const;
+	template <int MaxLives>
+	float expectimax(int depth);
+	template <int MaxLives>
+	float dealer_expectimax(int depth);
+	template <int MaxLives>
+	float player_expectimax(int depth);
+	template <int MaxLives, void (Node::*Apply)(void)>
+	float search_after(int depth, bool is_forked);
+	template <int MaxLives, void (Node::*First)(void), void (Node::*Second)(void)>
+	float search_chance(float first_probability, float second_probability, float scale, int depth);
+	template <int MaxLives>
+	float reload_expectimax(int depth);
 	float eval(void) const;
+	float estimate(void) const;
 	bool is_last_round(void) const;
-	std::array<Node, 4> get_states_after_shoot(void) const;
-	float calc_drink_beer_ev(float item_pickup_probability) const;
-	float calc_smoke_cigarette_ev(float item_pickup_probability) const;
-	float calc_use_magnifying_glass_ev(float item_pickup_probability) const;
-	float calc_use_handsaw_ev(float item_pickup_probability) const;
-    float calc_use_handcuffs_ev(float item_pickup_probability) const;
-    bool player_is_fade_charge(void) const;
-    bool dealer_is_fade_charge(void) const;
-
-	friend struct std::hash<Node>;
-
-	ItemManager dealer_items;
-	ItemManager player_items;
-
-	uint8_t live_round_count : 4;
-	uint8_t blank_round_count : 4;
-	uint8_t max_lives : 3;
-	uint8_t dealer_lives : 3;
-	uint8_t player_lives : 3;
-
-	bool is_dealer_turn : 1;
-	bool curr_is_live : 1;
-	bool curr_is_blank : 1;
-	bool handsaw_applied : 1;
-    bool handcuffs_applied : 1;
-    bool handcuffs_available : 1;
+	template <ItemKind Kind, bool IsDealerTurn>
+	void remove_acting_item(void);
+	template <int MaxLives, bool IsDealerTurn>
+	float calc_drink_beer_ev(float item_pickup_probability, int depth);
+	template <int MaxLives, bool IsDealerTurn>
+	float calc_smoke_cigarette_ev(float item_pickup_probability, int depth);
+	template <int MaxLives, bool IsDealerTurn>
+	float calc_use_magnifying_glass_ev(float item_pickup_probability, int depth);
+	template <int MaxLives, bool IsDealerTurn>
+	float calc_use_handsaw_ev(float item_pickup_probability, int depth);
+	template <int MaxLives, bool IsDealerTurn>
+	float calc_use_handcuffs_ev(float item_pickup_probability, int depth);
+	template <int MaxLives, bool IsDealerTurn>
+	float calc_use_adrenaline_ev(float item_pickup_probability, int depth);
+	template <int MaxLives, bool IsDealerTurn>
+	float calc_use_inverter_ev(float item_pickup_probability, int depth);
+	template <int MaxLives, bool IsDealerTurn>
+	float calc_use_expired_medicine_ev(float item_pickup_probability, int depth);
+	template <int MaxLives, bool IsDealerTurn>
+	float calc_use_burner_phone_ev(float item_pickup_probability, int depth);
+	template <int MaxLives>
+	std::array<bool, ACTION_COUNT> get_player_actions(void) const;
+	template <int MaxLives>
+	float search_player_action(Action action, int depth, bool should_fork);
+	template <int MaxLives>
+	bool player_is_fade_charge(void) const;
+	template <int MaxLives>
+	bool dealer_is_fade_charge(void) const;
+	bool should_fork(void) const;
+
+	template <int MaxLives, bool IsDealerTurn>
+	void apply_shoot_dealer_live(void);
+	template <int MaxLives, bool IsDealerTurn>
+	void apply_shoot_dealer_blank(void);
+	template <int MaxLives, bool IsDealerTurn>
+	void apply_shoot_player_live(void);
+	template <int MaxLives, bool IsDealerTurn>
+	void apply_shoot_player_blank(void);
+	template <int MaxLives, bool IsDealerTurn>
+	void apply_drink_beer_live(void);
+	template <int MaxLives, bool IsDealerTurn>
+	void apply_drink_beer_blank(void);
+	template <int MaxLives, bool IsDealerTurn>
+	void apply_smoke_cigarette(void);
+	template <int MaxLives, bool IsDealerTurn>
+	void apply_magnify_live(void);
+	template <int MaxLives, bool IsDealerTurn>
+	void apply_magnify_blank(void);
+	template <int MaxLives, bool IsDealerTurn>
+	void apply_use_handsaw(void);
+	template <int MaxLives, bool IsDealerTurn>
+	void apply_use_handcuffs(void);
+	template <int MaxLives, bool IsDealerTurn>
+	void apply_use_adrenaline(void);
+	template <int MaxLives, bool IsDealerTurn>
+	void apply_use_inverter(void);
+	template <int MaxLives, bool IsDealerTurn>
+	void apply_expired_medicine_heal(void);
+	template <int MaxLives, bool IsDealerTurn>
+	void apply_expired_medicine_damage(void);
+	template <int MaxLives, bool IsDealerTurn>
+	void apply_burner_phone_live(void);
+	template <int MaxLives, bool IsDealerTurn>
+	void apply_burner_phone_blank(void);
+	// Moves a round to the count of the other type, which is how an inverted round is settled.
+	template <bool IsLive>
+	void flip_counted_round(void);
+	template <bool IsLive>
+	void reveal_round(void);
+
+	friend class StateIndexer;
+
+	uint64_t state = 0;
 };
 
+static_assert(sizeof(Node) == sizeof(uint64_t));
+
 #endif
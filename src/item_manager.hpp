@@ -1,15 +1,51 @@
 #ifndef ITEM_MANAGER_HPP
 #define ITEM_MANAGER_HPP
+#include <array>
+#include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 
 class Node;
 
+// Item kinds in nibble order, least significant first.
+enum class ItemKind {
+	MAGNIFYING_GLASS,
+	CIGARETTE_PACK,
+	BEER,
+	HANDSAW,
+	HANDCUFFS,
+	ADRENALINE,
+	INVERTER,
+	EXPIRED_MEDICINE,
+	BURNER_PHONE,
+};
+
+constexpr int ITEM_KIND_COUNT = 9;
+// The kinds before ADRENALINE, those of the original game.
+constexpr int CLASSIC_ITEM_KIND_COUNT = 5;
+constexpr int ITEM_KIND_BITS = 4;
+// Items that do not fit on a side's full table are lost.
+constexpr int MAX_HELD_ITEM_COUNT = 8;
+// A Node keeps two bits per later kind and side, so a side holds at most 3 of each of those.
+// Further ones are lost like those that do not fit on the table. Classic kinds can fill a table.
+constexpr int MAX_LATER_ITEM_KIND_COUNT = 3;
+// Every load of double or nothing deals each side 1 to this many items, of all kinds.
+constexpr int DOUBLE_OR_NOTHING_MAX_ITEMS_PER_LOAD = 4;
+
+constexpr int get_max_item_kind_count(int kind) {
+	return kind < CLASSIC_ITEM_KIND_COUNT ? MAX_HELD_ITEM_COUNT : MAX_LATER_ITEM_KIND_COUNT;
+}
+
+// Item counts packed one nibble per kind into a 64-bit word. Every operation is a single add,
+// subtract or mask on the packed word; counts never exceed 8, so no nibble carries into its
+// neighbour.
 class ItemManager final {
    public:
 	explicit ItemManager(int magnifying_glass_count, int cigarette_pack_count, int beer_count,
-	                     int handsaw_count, int handcuff_count);
+	                     int handsaw_count, int handcuff_count, int adrenaline_count = 0,
+	                     int inverter_count = 0, int expired_medicine_count = 0,
+	                     int burner_phone_count = 0);
 
 	ItemManager() = default;
 
@@ -19,35 +55,147 @@ class ItemManager final {
 	ItemManager &operator=(ItemManager &&) = default;
 	bool operator==(const ItemManager &other) const;
 
-	bool has_magnifying_glass(void) const;
-	bool has_cigarette_pack(void) const;
-	bool has_beer(void) const;
-	bool has_handsaw(void) const;
-	bool has_handcuffs(void) const;
+	template <ItemKind Kind>
+	static constexpr int get_shift(void) {
+		return static_cast<int>(Kind) * ITEM_KIND_BITS;
+	}
+
+	// Bit 3 of the kind's nibble, as reported by get_presence_mask().
+	template <ItemKind Kind>
+	static constexpr uint64_t get_presence_bit(void) {
+		return uint64_t{0x8} << get_shift<Kind>();
+	}
 
-	bool get_magnifying_glass_count(void) const;
-	bool get_cigarette_pack_count(void) const;
-	bool get_beer_count(void) const;
-	bool get_handsaw_count(void) const;
-	bool get_handcuffs_count(void) const;
+	template <ItemKind Kind>
+	constexpr int get_count(void) const {
+		return this->items >> get_shift<Kind>() & 0xF;
+	}
 
-	void remove_magnifying_glass(void);
-	void remove_cigarette_pack(void);
-	void remove_beer(void);
-	void remove_handsaw(void);
-	void remove_handcuffs(void);
+	template <ItemKind Kind>
+	constexpr bool has(void) const {
+		return this->items & uint64_t{0xF} << get_shift<Kind>();
+	}
 
-	void add_magnifying_glass(void);
-	void add_cigarette_pack(void);
-	void add_beer(void);
-	void add_handsaw(void);
-	void add_handcuffs(void);
+	template <ItemKind Kind>
+	void add(void) {
+		assert(this->get_count<Kind>() < get_max_item_kind_count(static_cast<int>(Kind)));
+		this->items += uint64_t{1} << get_shift<Kind>();
+	}
 
-	int get_item_count(void) const;
+	template <ItemKind Kind>
+	void remove(void) {
+		assert(this->get_count<Kind>() > 0);
+		this->items -= uint64_t{1} << get_shift<Kind>();
+	}
+
+	// Sets bit 3 of every nibble that holds at least one item. Adding 7 sets bit 3 for counts 1-7
+	// and a count of 8 already has it; none of them carry out of the nibble.
+	constexpr uint64_t get_presence_mask(void) const {
+		return ((this->items + (KIND_NIBBLES & 0x7777777777777777u)) | this->items) &
+		       (KIND_NIBBLES & 0x8888888888888888u);
+	}
+
+	// Adds neighbouring nibbles into bytes, then all bytes into the top byte with one multiply.
+	constexpr int get_item_count(void) const {
+		const uint64_t byte_sums = (this->items & 0x0F0F0F0F0F0F0F0Fu) +
+		                           (this->items >> 4 & 0x0F0F0F0F0F0F0F0Fu);
+		return (byte_sums * 0x0101010101010101u) >> 56;
+	}
+
+	// Whether a side can hold these items: no more than MAX_HELD_ITEM_COUNT in all, and no more of
+	// a kind than get_max_item_kind_count().
+	constexpr bool can_be_held(void) const {
+		for (int kind = 0; kind < ITEM_KIND_COUNT; ++kind) {
+			if (static_cast<int>(this->items >> (kind * ITEM_KIND_BITS) & 0xF) >
+			    get_max_item_kind_count(kind)) {
+				return false;
+			}
+		}
+		return this->get_item_count() <= MAX_HELD_ITEM_COUNT;
+	}
 
    private:
-	friend struct std::hash<Node>;
+	friend class Node;
+	friend class StateIndexer;
 
-	uint32_t items = 0;
+	// The nibbles of the ITEM_KIND_COUNT kinds.
+	static constexpr uint64_t KIND_NIBBLES = (uint64_t{1} << ITEM_KIND_COUNT * ITEM_KIND_BITS) - 1;
+
+	uint64_t items = 0;
 };
+
+// Dense ranks of the classic kinds of every inventory a side can hold, which a Node keeps in place
+// of a nibble per kind. Counts c_0 to c_4 put bars at b_k = c_0 + ... + c_k + k among
+// MAX_HELD_ITEM_COUNT + CLASSIC_ITEM_KIND_COUNT slots, and the rank is that of the bars in the
+// combinatorial number system, the sum of binomial(b_k, k + 1).
+class ClassicInventoryTable final {
+   public:
+	// binomial(MAX_HELD_ITEM_COUNT + CLASSIC_ITEM_KIND_COUNT, CLASSIC_ITEM_KIND_COUNT)
+	static constexpr int SIZE = 1287;
+
+	constexpr ClassicInventoryTable(void) {
+		for (int n = 0; n < SLOT_COUNT; ++n) {
+			this->binomials[n][0] = 1;
+			for (int k = 1; k <= CLASSIC_ITEM_KIND_COUNT; ++k) {
+				this->binomials[n][k] =
+				    n == 0 ? 0 : this->binomials[n - 1][k - 1] + this->binomials[n - 1][k];
+			}
+		}
+		for (int rank = 0; rank < SIZE; ++rank) {
+			// Takes the bars from the last one down, each at the highest slot its rank allows.
+			int rest = rank;
+			int next_bar = SLOT_COUNT;
+			uint64_t items = 0;
+			for (int kind = CLASSIC_ITEM_KIND_COUNT - 1; kind >= 0; --kind) {
+				int bar = kind;
+				while (bar + 1 < SLOT_COUNT && this->binomials[bar + 1][kind + 1] <= rest) {
+					++bar;
+				}
+				rest -= this->binomials[bar][kind + 1];
+				if (kind < CLASSIC_ITEM_KIND_COUNT - 1) {
+					items |= static_cast<uint64_t>(next_bar - bar - 1)
+					         << ((kind + 1) * ITEM_KIND_BITS);
+				}
+				next_bar = bar;
+			}
+			this->items[rank] = items | static_cast<uint64_t>(next_bar);
+		}
+		for (int rank = 0; rank < SIZE; ++rank) {
+			for (int kind = 0; kind < CLASSIC_ITEM_KIND_COUNT; ++kind) {
+				const uint64_t item = uint64_t{1} << (kind * ITEM_KIND_BITS);
+				this->counts[rank] += this->items[rank] >> (kind * ITEM_KIND_BITS) & 0xF;
+				this->removed[rank][kind] = static_cast<uint16_t>(
+				    this->items[rank] >> (kind * ITEM_KIND_BITS) & 0xF
+				        ? this->get_rank(this->items[rank] - item)
+				        : rank);
+			}
+		}
+	}
+
+	// Rank of the classic kinds of items, packed as in ItemManager.
+	constexpr int get_rank(uint64_t items) const {
+		int rank = 0;
+		for (int kind = 0, bar = -1; kind < CLASSIC_ITEM_KIND_COUNT; ++kind) {
+			bar += static_cast<int>(items >> (kind * ITEM_KIND_BITS) & 0xF) + 1;
+			assert(bar < SLOT_COUNT);
+			rank += this->binomials[bar][kind + 1];
+		}
+		return rank;
+	}
+
+	// The classic items of every rank, packed as in ItemManager.
+	std::array<uint32_t, SIZE> items{};
+	// The rank after using up an item of a kind, by rank and kind. Kinds that are not held keep
+	// the rank.
+	std::array<std::array<uint16_t, CLASSIC_ITEM_KIND_COUNT>, SIZE> removed{};
+	// The number of classic items of every rank.
+	std::array<uint8_t, SIZE> counts{};
+
+   private:
+	static constexpr int SLOT_COUNT = MAX_HELD_ITEM_COUNT + CLASSIC_ITEM_KIND_COUNT;
+
+	std::array<std::array<int, CLASSIC_ITEM_KIND_COUNT + 1>, SLOT_COUNT> binomials{};
+};
+
+inline constexpr ClassicInventoryTable CLASSIC_INVENTORY_TABLE;
 #endif  // ITEM_MANAGER_HPP
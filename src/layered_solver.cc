@@ -0,0 +1,146 @@
+#include "layered_solver.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "search_context.hpp"
+
+// States of a layer handed to one task.
+constexpr std::size_t LAYER_CHUNK_SIZE = 4096;
+
+namespace {
+// Files the children of the expanded states by layer, unsorted and with duplicates.
+class ChildCollector final : public ChildVisitor {
+   public:
+	explicit ChildCollector(std::size_t layer_count) : children(layer_count) {}
+
+	float visit(const Node &child) override {
+		this->children[child.get_subtree_depth()].push_back(child.get_canonical_key());
+		return 0.0f;
+	}
+
+	std::vector<std::vector<uint64_t>> children;
+};
+}  // namespace
+
+// Answers the children of a state from the layers below it, which are evaluated by then.
+class LayeredSolver::ChildLookup final : public ChildVisitor {
+   public:
+	explicit ChildLookup(const std::vector<Layer> &layers) : layers(layers) {}
+
+	float visit(const Node &child) override {
+		const Layer &layer = this->layers[child.get_subtree_depth()];
+		const uint64_t key = child.get_canonical_key();
+		const auto it = std::lower_bound(layer.keys.begin(), layer.keys.end(), key);
+		assert(it != layer.keys.end() && *it == key);
+		return layer.evs[it - layer.keys.begin()];
+	}
+
+   private:
+	const std::vector<Layer> &layers;
+};
+
+LayeredSolver::LayeredSolver(const Node &root, SearchContext &context)
+    : root(root), context(context) {}
+
+std::pair<Action, float> LayeredSolver::get_best_action(void) {
+	assert(this->root.is_player_turn());
+	this->solve();
+	ChildLookup lookup(this->layers);
+	return this->root.get_best_action(lookup, this->context);
+}
+
+float LayeredSolver::get_ev(void) {
+	if (this->root.is_terminal()) {
+		return this->root.get_ev(this->context);
+	}
+	this->solve();
+	ChildLookup lookup(this->layers);
+	if (this->root.is_player_turn()) {
+		return this->root.get_best_action(lookup, this->context).second;
+	}
+	return this->root.expand(lookup, this->context);
+}
+
+std::size_t LayeredSolver::get_state_count(void) const {
+	std::size_t state_count = 0;
+	for (const Layer &layer : this->layers) {
+		state_count += layer.keys.size();
+	}
+	return state_count;
+}
+
+void LayeredSolver::solve(void) {
+	if (!this->is_solved) {
+		this->collect_layers();
+		this->evaluate_layers();
+		this->is_solved = true;
+	}
+}
+
+// Calls function(begin, end) for consecutive chunks of [0, size) on the scheduler of the context
+// and waits for all of them, or on the caller if it has none.
+template <typename Function>
+void LayeredSolver::for_each_chunk(std::size_t size, Function &&function) {
+	TaskScheduler *scheduler = this->context.get_scheduler();
+	if (!scheduler) {
+		for (std::size_t begin = 0; begin < size; begin += LAYER_CHUNK_SIZE) {
+			function(begin, std::min(size, begin + LAYER_CHUNK_SIZE));
+		}
+		return;
+	}
+	TaskGroup group(*scheduler);
+	for (std::size_t begin = 0; begin < size; begin += LAYER_CHUNK_SIZE) {
+		const std::size_t end = std::min(size, begin + LAYER_CHUNK_SIZE);
+		group.spawn([&function, begin, end] { function(begin, end); });
+	}
+	group.wait();
+}
+
+// The children of a layer are all known once every higher layer has been expanded, so the layers
+// are completed from the root down.
+void LayeredSolver::collect_layers(void) {
+	const std::size_t root_depth = this->root.get_subtree_depth();
+	this->layers.assign(root_depth, Layer{});
+
+	auto file_children = [this](const std::vector<std::vector<uint64_t>> &children) {
+		for (std::size_t depth = 0; depth < children.size(); ++depth) {
+			this->layers[depth].keys.insert(this->layers[depth].keys.end(), children[depth].begin(),
+			                                children[depth].end());
+		}
+	};
+
+	ChildCollector root_collector(root_depth);
+	this->root.expand(root_collector, this->context);
+	file_children(root_collector.children);
+
+	for (std::size_t depth = root_depth; depth-- > 0;) {
+		std::vector<uint64_t> &keys = this->layers[depth].keys;
+		std::sort(keys.begin(), keys.end());
+		keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+		std::vector<ChildCollector> collectors(
+		    (keys.size() + LAYER_CHUNK_SIZE - 1) / LAYER_CHUNK_SIZE, ChildCollector(depth));
+		this->for_each_chunk(keys.size(), [&](std::size_t begin, std::size_t end) {
+			ChildCollector &collector = collectors[begin / LAYER_CHUNK_SIZE];
+			for (std::size_t i = begin; i < end; ++i) {
+				Node::from_key(keys[i]).expand(collector, this->context);
+			}
+		});
+		for (ChildCollector &collector : collectors) {
+			file_children(collector.children);
+		}
+	}
+}
+
+void LayeredSolver::evaluate_layers(void) {
+	ChildLookup lookup(this->layers);
+	for (Layer &layer : this->layers) {
+		layer.evs.resize(layer.keys.size());
+		this->for_each_chunk(layer.keys.size(), [&](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				layer.evs[i] = Node::from_key(layer.keys[i]).expand(lookup, this->context);
+			}
+		});
+	}
+}
@@ -0,0 +1,48 @@
+#ifndef LAYERED_SOLVER_HPP
+#define LAYERED_SOLVER_HPP
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "expectimax.hpp"
+
+// Solves a position bottom-up instead of recursively. Every transition uses up a shell or an item,
+// so the states reachable from the root fall into layers by get_subtree_depth(), each depending on
+// lower layers only. The solver collects the layers from the root down, then evaluates them from
+// the bottom up with one pass over contiguous arrays per layer, split across threads. Every state
+// is searched a single ply deep (Node::expand()) with the EVs of its children looked up in the
+// layers below, so the EVs are bit for bit those of the recursive search.
+//
+// States are kept by their canonical key, which costs 12 bytes per reachable state and no
+// transposition table. Only the next load of a campaign is searched, on context and the threads of
+// its scheduler.
+class LayeredSolver final {
+   public:
+	explicit LayeredSolver(const Node &root, SearchContext &context = get_default_search_context());
+
+	// Same as the Node functions of the same name, the first needs the player to move.
+	std::pair<Action, float> get_best_action(void);
+	float get_ev(void);
+	std::size_t get_state_count(void) const;
+
+   private:
+	struct Layer {
+		std::vector<uint64_t> keys;  // sorted
+		std::vector<float> evs;
+	};
+	class ChildLookup;
+
+	void solve(void);
+	void collect_layers(void);
+	void evaluate_layers(void);
+	template <typename Function>
+	void for_each_chunk(std::size_t size, Function &&function);
+
+	Node root;
+	SearchContext &context;
+	std::vector<Layer> layers;  // indexed by subtree depth
+	bool is_solved = false;
+};
+
+#endif  // LAYERED_SOLVER_HPP
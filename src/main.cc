@@ -1,19 +1,89 @@
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <limits>
+#include <numeric>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "batch.hpp"
+#include "buckshot_roulette.h"
 #include "expectimax.hpp"
 #include "item_manager.hpp"
+#include "perft.hpp"
+#include "search_context.hpp"
+#include "search_stats.hpp"
+#include "server.hpp"
+#include "transposition_table.hpp"
+
+// Double or nothing fills more of the table with its larger positions.
+constexpr std::size_t DOUBLE_OR_NOTHING_DEFAULT_HASH_SIZE_MB =
+    4 * TRANSPOSITION_TABLE_DEFAULT_SIZE_MB;
 
 struct Args {
 	bool should_output_help = false;
+	bool should_output_stats = false;
+	bool is_layered = false;
+	bool is_campaign = false;
+	bool is_double_or_nothing = false;
+	bool is_hash_size_set = false;
+	bool is_budget_set = false;
+	std::size_t hash_size_mb = TRANSPOSITION_TABLE_DEFAULT_SIZE_MB;
+	std::size_t thread_count = 1;
+	int parallel_cutoff = DEFAULT_PARALLEL_CUTOFF;
+	int perft_plies = 0;
+	SearchBudget budget;
+	std::string tablebase_path;
+	std::string batch_path;
+	std::string perft_path;
+	std::string socket_path;
 };
 
 void print_help(void) {
 	std::cout << "Usage: buckshot-roulettee [FLAGS]\n"
 	          << "  --help, --h        : Print this help message.\n"
+	          << "  --hash <MB>        : Size of the transposition table in megabytes (default "
+	          << TRANSPOSITION_TABLE_DEFAULT_SIZE_MB << ").\n"
+	          << "  --threads <N>      : Search on N threads (default 1).\n"
+	          << "  --parallel-cutoff <N>: Only split subtrees with at least N shells and items\n"
+	          << "                       left into parallel tasks (default "
+	          << DEFAULT_PARALLEL_CUTOFF << ").\n"
+	          << "  --movetime <MS>    : Return the best action found within MS milliseconds,\n"
+	          << "                       searching fewer shells ahead if needed (default none).\n"
+	          << "  --nodes <N>        : Same with a budget of about N searched nodes.\n"
+	          << "  --layered          : Solve exactly with the bottom-up layered solver instead\n"
+	          << "                       of the recursive search (ignored with a budget).\n"
+	          << "  --campaign         : Look one load past the current one instead of scoring\n"
+	          << "                       the lives when the shotgun is empty (batch: see\n"
+	          << "                       src/batch.hpp).\n"
+	          << "  --double-or-nothing: Campaign of double or nothing, every load deals 1 to "
+	          << DOUBLE_OR_NOTHING_MAX_ITEMS_PER_LOAD << " items of\n"
+	          << "                       all kinds. Searches get "
+	          << DOUBLE_OR_NOTHING_DEFAULT_MOVETIME.count() << " ms and a "
+	          << DOUBLE_OR_NOTHING_DEFAULT_HASH_SIZE_MB << " MB hash unless\n"
+	          << "                       set otherwise (--movetime 0 searches the whole load).\n"
+	          << "  --tablebase <PATH> : Answer positions covered by a tablebase file without\n"
+	          << "                       search.\n"
+	          << "  --batch <PATH|->   : Solve the positions in PATH (or stdin), one per line,\n"
+	          << "                       and print the best action and EV for each. See\n"
+	          << "                       src/batch.hpp.\n"
+	          << "  --perft <PATH|->   : Count the positions below every position in PATH (or\n"
+	          << "                       stdin) ply by ply, as a tree and as distinct states,\n"
+	          << "                       and time the move generation. Same format as --batch.\n"
+	          << "  --perft-depth <N>  : Stop --perft after N plies (default the whole load).\n"
+	          << "  --serve <PATH>     : Answer batch format queries on a Unix domain socket at\n"
+	          << "                       PATH with caches that stay warm across clients. Serves\n"
+	          << "                       " << SERVER_WORKER_COUNT
+	          << " clients at once on one table of --hash MB, and drops\n"
+	          << "                       clients idle for " << SERVER_IDLE_TIMEOUT.count()
+	          << " seconds.\n"
+	          << "  --stats            : Print search counters after every search (or once at\n"
+	          << "                       the end of a batch). Needs BUCKSHOT_SEARCH_STATS at\n"
+	          << "                       build time.\n"
 	          << "  (No flags)         : Run the solver.\n";
 }
 
@@ -24,45 +94,130 @@ Args parse_cmd_args(int argc, char **argv) {
 		if (curr == "--h" || curr == "--help") {
 			args.should_output_help = true;
 		}
+		else if (curr == "--hash" && i + 1 < argc) {
+			try {
+				args.hash_size_mb = std::stoul(argv[++i]);
+				args.is_hash_size_set = true;
+			}
+			catch (const std::exception &) {
+				std::cerr << "[WARNING] Invalid hash size '" << argv[i] << "', using default.\n";
+			}
+		}
+		else if (curr == "--threads" && i + 1 < argc) {
+			try {
+				args.thread_count = std::stoul(argv[++i]);
+			}
+			catch (const std::exception &) {
+				std::cerr << "[WARNING] Invalid thread count '" << argv[i] << "', using default.\n";
+			}
+		}
+		else if (curr == "--parallel-cutoff" && i + 1 < argc) {
+			try {
+				args.parallel_cutoff = std::stoi(argv[++i]);
+			}
+			catch (const std::exception &) {
+				std::cerr << "[WARNING] Invalid parallel cutoff '" << argv[i]
+				          << "', using default.\n";
+			}
+		}
+		else if (curr == "--movetime" && i + 1 < argc) {
+			try {
+				args.budget.time = std::chrono::milliseconds(std::stoul(argv[++i]));
+				args.is_budget_set = true;
+			}
+			catch (const std::exception &) {
+				std::cerr << "[WARNING] Invalid move time '" << argv[i] << "', using no limit.\n";
+			}
+		}
+		else if (curr == "--nodes" && i + 1 < argc) {
+			try {
+				args.budget.nodes = std::stoull(argv[++i]);
+				args.is_budget_set = true;
+			}
+			catch (const std::exception &) {
+				std::cerr << "[WARNING] Invalid node budget '" << argv[i] << "', using no limit.\n";
+			}
+		}
+		else if (curr == "--stats") {
+			args.should_output_stats = true;
+		}
+		else if (curr == "--layered") {
+			args.is_layered = true;
+		}
+		else if (curr == "--campaign") {
+			args.is_campaign = true;
+		}
+		else if (curr == "--double-or-nothing") {
+			args.is_campaign = true;
+			args.is_double_or_nothing = true;
+		}
+		else if (curr == "--batch" && i + 1 < argc) {
+			args.batch_path = argv[++i];
+		}
+		else if (curr == "--perft" && i + 1 < argc) {
+			args.perft_path = argv[++i];
+		}
+		else if (curr == "--perft-depth" && i + 1 < argc) {
+			try {
+				args.perft_plies = std::stoi(argv[++i]);
+			}
+			catch (const std::exception &) {
+				std::cerr << "[WARNING] Invalid perft depth '" << argv[i] << "', using no limit.\n";
+			}
+		}
+		else if (curr == "--serve" && i + 1 < argc) {
+			args.socket_path = argv[++i];
+		}
+		else if (curr == "--tablebase" && i + 1 < argc) {
+			args.tablebase_path = argv[++i];
+		}
 		else {
 			std::cerr << "[WARNING] Ignoring command line argument '" << curr << "'.\n";
 		}
 	}
+	if (args.is_double_or_nothing && !args.is_hash_size_set) {
+		args.hash_size_mb = DOUBLE_OR_NOTHING_DEFAULT_HASH_SIZE_MB;
+	}
+	if (args.is_double_or_nothing && !args.is_budget_set) {
+		args.budget.time = DOUBLE_OR_NOTHING_DEFAULT_MOVETIME;
+	}
 	return args;
 }
 
-ItemManager prompt_items(std::string_view prompt) {
+// Item names as typed at the prompt, by buckshot_item_kind.
+constexpr std::array<std::string_view, BUCKSHOT_ITEM_KIND_COUNT> ITEM_NAMES = {
+    "magnifying glass", "cigarettes", "beer",         "handsaw",     "handcuffs",
+    "adrenaline",       "inverter",   "expired medicine", "burner phone"};
+
+void prompt_items(std::string_view prompt, int *counts) {
 	std::cout << prompt << '\n';
 	std::string curr_line;
 	std::getline(std::cin, curr_line);
 
-	ItemManager items;
+	std::fill(counts, counts + BUCKSHOT_ITEM_KIND_COUNT, 0);
 
 	while (!curr_line.empty()) {
-		if (curr_line == "beer") {
-			items.add_beer();
-		}
-		else if (curr_line == "cigarettes") {
-			items.add_cigarette_pack();
-		}
-		else if (curr_line == "magnifying glass") {
-			items.add_magnifying_glass();
+		const auto name = std::find(ITEM_NAMES.begin(), ITEM_NAMES.end(), curr_line);
+		if (name == ITEM_NAMES.end()) {
+			std::cout << "[ERROR] Unknown item name '" << curr_line
+			          << "'\nAvailable items: beer, cigarettes, magnifying glass, handsaw, "
+			             "handcuffs, adrenaline, inverter, expired medicine and burner phone.\n";
 		}
-		else if (curr_line == "handsaw") {
-			items.add_handsaw();
+		else if (std::accumulate(counts, counts + BUCKSHOT_ITEM_KIND_COUNT, 0) ==
+		         MAX_HELD_ITEM_COUNT) {
+			std::cout << "[ERROR] A side holds at most " << MAX_HELD_ITEM_COUNT
+			          << " items, ignoring it.\n";
 		}
-		else if (curr_line == "handcuffs") {
-			items.add_handcuffs();
+		else if (counts[name - ITEM_NAMES.begin()] ==
+		         get_max_item_kind_count(name - ITEM_NAMES.begin())) {
+			std::cout << "[ERROR] At most " << MAX_LATER_ITEM_KIND_COUNT << " " << *name
+			          << " items are supported, ignoring it.\n";
 		}
 		else {
-			std::cout << "[ERROR] Unknown item name '" << curr_line
-			          << "'\nAvailable items: beer, cigarettes, magnifying glass, handsaw and "
-			             "handcuffs.\n";
+			++counts[name - ITEM_NAMES.begin()];
 		}
 		std::getline(std::cin, curr_line);
 	}
-
-	return items;
 }
 
 template <typename... Args>
@@ -102,28 +257,67 @@ bool prompt_is_live(std::string_view prompt) {
 	}
 }
 
-std::string action_to_str(Action action) {
+std::string action_to_str(buckshot_action action) {
+	const char *name = buckshot_action_name(action);
+	assert(name != nullptr);
+	std::string str = name ? name : "";
+	std::replace(str.begin(), str.end(), '_', ' ');
+	return str;
+}
+
+buckshot_item_kind get_item_kind(buckshot_action item_action) {
+	switch (item_action) {
+		case BUCKSHOT_DRINK_BEER:
+			return BUCKSHOT_BEER;
+		case BUCKSHOT_SMOKE_CIGARETTE:
+			return BUCKSHOT_CIGARETTE_PACK;
+		case BUCKSHOT_USE_MAGNIFYING_GLASS:
+			return BUCKSHOT_MAGNIFYING_GLASS;
+		case BUCKSHOT_USE_HANDSAW:
+			return BUCKSHOT_HANDSAW;
+		case BUCKSHOT_USE_HANDCUFFS:
+			return BUCKSHOT_HANDCUFFS;
+		case BUCKSHOT_USE_ADRENALINE:
+			return BUCKSHOT_ADRENALINE;
+		case BUCKSHOT_USE_INVERTER:
+			return BUCKSHOT_INVERTER;
+		case BUCKSHOT_USE_EXPIRED_MEDICINE:
+			return BUCKSHOT_EXPIRED_MEDICINE;
+		case BUCKSHOT_USE_BURNER_PHONE:
+			return BUCKSHOT_BURNER_PHONE;
+		default:
+			assert(false);
+			return BUCKSHOT_BEER;
+	}
+}
+
+// Asks for what an action did that the position does not know, see
+// buckshot_action_needs_outcome().
+std::string_view get_outcome_prompt(buckshot_action action, bool is_dealer_turn) {
 	switch (action) {
-		case Action::SHOOT_DEALER:
-			return "shoot dealer";
-		case Action::SHOOT_PLAYER:
-			return "shoot player";
-		case Action::DRINK_BEER:
-			return "drink beer";
-		case Action::SMOKE_CIGARETTE:
-			return "smoke cigarette pack";
-		case Action::USE_MAGNIFYING_GLASS:
-			return "use magnifying glass";
-		case Action::USE_HANDSAW:
-			return "use handsaw";
-		case Action::USE_HANDCUFFS:
-			return "use handcuffs";
+		case BUCKSHOT_SHOOT_DEALER:
+			return is_dealer_turn ? "[PROMPT] Dealer damaged himself (y/n): "
+			                      : "[PROMPT] Player damaged the dealer (y/n): ";
+		case BUCKSHOT_SHOOT_PLAYER:
+			return is_dealer_turn ? "[PROMPT] Dealer damaged the player (y/n): "
+			                      : "[PROMPT] Player damaged himself (y/n): ";
+		case BUCKSHOT_DRINK_BEER:
+			return is_dealer_turn ? "[PROMPT] Dealer's beer ejected a live round (y/n): "
+			                      : "[PROMPT] Player's beer ejected a live round (y/n): ";
+		case BUCKSHOT_USE_MAGNIFYING_GLASS:
+			return "[PROMPT] Player's magnifying glass showed a live round (y/n): ";
+		case BUCKSHOT_USE_EXPIRED_MEDICINE:
+			return is_dealer_turn ? "[PROMPT] Dealer's expired medicine healed (y/n): "
+			                      : "[PROMPT] Player's expired medicine healed (y/n): ";
+		case BUCKSHOT_USE_BURNER_PHONE:
+			return "[PROMPT] The burner phone showed a live last round (y/n): ";
 		default:
 			assert(false);
+			return "";
 	}
 }
 
-Action prompt_action(const std::vector<Action> &available_actions) {
+buckshot_action prompt_action(const std::vector<buckshot_action> &available_actions) {
 	std::cout << "\n[PROMPT] Select an action for the dealer:\n";
 	for (size_t i = 0; i < available_actions.size(); ++i) {
 		std::cout << "  " << i + 1 << ". " << action_to_str(available_actions[i]) << '\n';
@@ -154,236 +348,150 @@ int main(int argc, char **argv) {
 		print_help();
 	}
 	else {
-		int round_num = prompt_num(1, 3, "[PROMPT] Enter current round number (1-3): ");
+		if (buckshot_set_hash_size_mb(args.hash_size_mb) != BUCKSHOT_OK ||
+		    buckshot_set_thread_count(args.thread_count) != BUCKSHOT_OK) {
+			std::cerr << "[ERROR] Out of memory.\n";
+			return 1;
+		}
+		buckshot_set_parallel_cutoff(args.parallel_cutoff);
+		if (!args.tablebase_path.empty() &&
+		    buckshot_open_tablebase(args.tablebase_path.c_str()) != BUCKSHOT_OK) {
+			std::cerr << "[WARNING] Could not load tablebase '" << args.tablebase_path << "'.\n";
+		}
 
-		uint8_t player_lives;
-		uint8_t dealer_lives;
-		uint8_t max_lives;
-
-		switch (round_num) {
-			case 1:
-				dealer_lives = prompt_num(1, 2, "[PROMPT] Enter dealer lives (1-2): ");
-				player_lives = prompt_num(1, 2, "[PROMPT] Enter player lives (1-2): ");
-				max_lives = 2;
-				break;
-			case 2:
-				dealer_lives = prompt_num(1, 4, "[PROMPT] Enter dealer lives (1-4): ");
-				player_lives = prompt_num(1, 4, "[PROMPT] Enter player lives (1-4): ");
-				max_lives = 4;
-				break;
-			case 3:
-				dealer_lives = prompt_num(1, 6, "[PROMPT] Enter dealer lives (1-6): ");
-				player_lives = prompt_num(1, 6, "[PROMPT] Enter player lives (1-6): ");
-				max_lives = 6;
-				break;
-			default:
-				assert(false);
-		}
-
-		uint8_t live_round_count = prompt_num(0, 8, "[PROMPT] Enter live round count (0-8): ");
-		uint8_t blank_round_count =
-		    prompt_num(live_round_count > 0 ? 0 : 1, 8 - live_round_count,
-		               "[PROMPT] Enter blank round count (", (live_round_count > 0 ? "0" : "1"),
-		               "-", std::to_string(8 - live_round_count), "): ");
-
-		ItemManager dealer_items;
-		ItemManager player_items;
-
-		if (round_num > 1) {
-			dealer_items = prompt_items("[PROMPT] Enter dealer items (end with an empty line): ");
-			player_items = prompt_items("[PROMPT] Enter player items (end with an empty line): ");
-		}
-
-		Node node(false, false, false, live_round_count, blank_round_count, max_lives, dealer_lives,
-		          player_lives, dealer_items, player_items);
-
-		while (!node.is_terminal()) {
-			std::cout << "[INFO] " << node.get_live_round_count() << " live rounds and "
-			          << node.get_blank_round_count() << " blank rounds. Dealer has "
-			          << node.get_dealer_lives() << " lives and player has "
-			          << node.get_player_lives() << " lives.\n";
-			if (node.is_player_turn()) {
-				std::cout << "[INFO] It's the player's turn.\n";
-				auto [best_action, ev] = node.get_best_action();
-
-				std::string action_str = action_to_str(best_action);
-				std::cout << "\n[INFO] Best action: " << action_str << " with eval " << ev << ".\n";
-
-				switch (best_action) {
-					case Action::SHOOT_DEALER: {
-						if (node.is_only_live_rounds() || node.round_known_live()) {
-							node.apply_shoot_dealer_live();
-							break;
-						}
-						if (node.is_only_blank_rounds() || node.round_known_blank()) {
-							node.apply_shoot_dealer_blank();
-							break;
-						}
-						bool is_live = prompt_is_live("[PROMPT] Player damaged the dealer (y/n): ");
-						if (is_live) {
-							node.apply_shoot_dealer_live();
-						}
-						else {
-							node.apply_shoot_dealer_blank();
-						}
-					} break;
-					case Action::SHOOT_PLAYER: {
-						if (node.is_only_live_rounds() || node.round_known_live()) {
-							node.apply_shoot_player_live();
-							break;
-						}
-						if (node.is_only_blank_rounds() || node.round_known_blank()) {
-							node.apply_shoot_player_blank();
-							break;
-						}
-						bool is_live = prompt_is_live("[PROMPT] Player damaged himself (y/n): ");
-						if (is_live) {
-							node.apply_shoot_player_live();
-						}
-						else {
-							node.apply_shoot_player_blank();
-						}
-						break;
-					}
-					case Action::DRINK_BEER: {
-						if (node.is_only_live_rounds() || node.round_known_live()) {
-							node.apply_drink_beer_live();
-							break;
-						}
-						if (node.is_only_blank_rounds() || node.round_known_blank()) {
-							node.apply_drink_beer_blank();
-							break;
-						}
-						bool is_live =
-						    prompt_is_live("[PROMPT] Player's beer ejected a live round (y/n): ");
-						if (is_live) {
-							node.apply_drink_beer_live();
-						}
-						else {
-							node.apply_drink_beer_blank();
-						}
-						break;
-					}
-					case Action::SMOKE_CIGARETTE:
-						node.apply_smoke_cigarette();
-						break;
-					case Action::USE_MAGNIFYING_GLASS: {
-						bool is_live = prompt_is_live(
-						    "[PROMPT] Player's magnifying glass showed a live round (y/n): ");
-						if (is_live) {
-							node.apply_magnify_live();
-						}
-						else {
-							node.apply_magnify_blank();
-						}
-						break;
-					}
-					case Action::USE_HANDSAW:
-						node.apply_use_handsaw();
-						break;
-					case Action::USE_HANDCUFFS:
-						node.apply_use_handcuffs();
-						break;
-					default:
-						assert(false);
+		if (!args.socket_path.empty()) {
+			return run_server(args.socket_path, args.budget);
+		}
+
+		if (args.should_output_stats && !buckshot_stats_enabled()) {
+			std::cerr << "[WARNING] Search counters were compiled out, ignoring --stats.\n";
+			args.should_output_stats = false;
+		}
+
+		if (!args.perft_path.empty()) {
+			if (args.perft_path == "-") {
+				run_perft_batch(std::cin, std::cout, args.perft_plies);
+			}
+			else {
+				std::ifstream perft_file(args.perft_path);
+				if (!perft_file) {
+					std::cerr << "[ERROR] Could not open '" << args.perft_path << "'.\n";
+					return 1;
 				}
+				run_perft_batch(perft_file, std::cout, args.perft_plies);
+			}
+			return 0;
+		}
+
+		if (!args.batch_path.empty()) {
+			if (args.batch_path == "-") {
+				run_batch(std::cin, std::cout, args.budget, args.is_layered);
 			}
 			else {
-				std::cout << "[INFO] It's the dealer's turn.\n";
+				std::ifstream batch_file(args.batch_path);
+				if (!batch_file) {
+					std::cerr << "[ERROR] Could not open '" << args.batch_path << "'.\n";
+					return 1;
+				}
+				run_batch(batch_file, std::cout, args.budget, args.is_layered);
+			}
+			if (args.should_output_stats) {
+				print_search_stats(std::cerr, get_default_search_context().collect_stats());
+			}
+			return 0;
+		}
 
-				ItemManager dealer_items = node.get_dealer_items();
-				std::vector<Action> dealer_available_actions = {Action::SHOOT_DEALER,
-				                                                Action::SHOOT_PLAYER};
+		int round_num = prompt_num(1, 3, "[PROMPT] Enter current round number (1-3): ");
 
-				if (dealer_items.has_beer()) {
-					dealer_available_actions.emplace_back(Action::DRINK_BEER);
-				}
-				if (dealer_items.has_cigarette_pack()) {
-					dealer_available_actions.emplace_back(Action::SMOKE_CIGARETTE);
+		buckshot_position_desc desc = {};
+		desc.max_lives = 2 * round_num;
+		desc.dealer_lives = prompt_num(1, desc.max_lives, "[PROMPT] Enter dealer lives (1-",
+		                               desc.max_lives, "): ");
+		desc.player_lives = prompt_num(1, desc.max_lives, "[PROMPT] Enter player lives (1-",
+		                               desc.max_lives, "): ");
+		desc.live_round_count = prompt_num(0, 8, "[PROMPT] Enter live round count (0-8): ");
+		desc.blank_round_count = prompt_num(
+		    desc.live_round_count > 0 ? 0 : 1, 8 - desc.live_round_count,
+		    "[PROMPT] Enter blank round count (", (desc.live_round_count > 0 ? "0" : "1"), "-",
+		    std::to_string(8 - desc.live_round_count), "): ");
+
+		if (round_num > 1 || args.is_double_or_nothing) {
+			prompt_items("[PROMPT] Enter dealer items (end with an empty line): ",
+			             desc.dealer_items);
+			prompt_items("[PROMPT] Enter player items (end with an empty line): ",
+			             desc.player_items);
+		}
+		desc.mode = args.is_double_or_nothing ? BUCKSHOT_MODE_DOUBLE_OR_NOTHING
+		            : args.is_campaign        ? BUCKSHOT_MODE_CAMPAIGN
+		                                      : BUCKSHOT_MODE_SINGLE_LOAD;
+
+		buckshot_position position;
+		if (buckshot_position_make(&desc, &position) != BUCKSHOT_OK) {
+			assert(false);
+			return 1;
+		}
+
+		const buckshot_search_options options = {
+		    static_cast<uint64_t>(args.budget.time.count()), args.budget.nodes, args.is_layered};
+
+		while (!buckshot_position_is_terminal(position)) {
+			buckshot_position_describe(position, &desc);
+			std::cout << "[INFO] " << desc.live_round_count << " live rounds and "
+			          << desc.blank_round_count << " blank rounds. Dealer has " << desc.dealer_lives
+			          << " lives and player has " << desc.player_lives << " lives.\n";
+
+			buckshot_action action;
+			if (!desc.is_dealer_turn) {
+				std::cout << "[INFO] It's the player's turn.\n";
+				buckshot_reset_stats();
+				buckshot_result best;
+				if (buckshot_get_best_action(position, &options, &best) != BUCKSHOT_OK) {
+					std::cerr << "[ERROR] Out of memory.\n";
+					return 1;
 				}
-				if (dealer_items.has_magnifying_glass()) {
-					dealer_available_actions.emplace_back(Action::USE_MAGNIFYING_GLASS);
+				action = static_cast<buckshot_action>(best.action);
+				if (args.should_output_stats) {
+					print_search_stats(std::cout, get_default_search_context().collect_stats());
 				}
-				if (dealer_items.has_handsaw()) {
-					dealer_available_actions.emplace_back(Action::USE_HANDSAW);
+
+				std::cout << "\n[INFO] Best action: " << action_to_str(action) << " with eval "
+				          << best.ev << ".\n";
+				const int shell_count = desc.live_round_count + desc.blank_round_count;
+				if (best.shell_horizon < shell_count) {
+					std::cout << "[INFO] Out of time, the eval only looks " << best.shell_horizon
+					          << " of " << shell_count << " shells ahead.\n";
 				}
-				if (dealer_items.has_handcuffs()) {
-					dealer_available_actions.emplace_back(Action::USE_HANDCUFFS);
+				else if (!best.is_exact) {
+					std::cout << "[INFO] The eval estimates the next load.\n";
 				}
+			}
+			else {
+				std::cout << "[INFO] It's the dealer's turn.\n";
 
-				Action dealer_action = prompt_action(dealer_available_actions);
-
-				switch (dealer_action) {
-					case Action::SHOOT_DEALER: {
-						if (node.is_only_live_rounds() || node.round_known_live()) {
-							node.apply_shoot_dealer_live();
-							break;
-						}
-						if (node.is_only_blank_rounds() || node.round_known_blank()) {
-							node.apply_shoot_dealer_blank();
-							break;
-						}
-						bool is_live = prompt_is_live("[PROMPT] Dealer damaged himself (y/n): ");
-						if (is_live) {
-							node.apply_shoot_dealer_live();
-						}
-						else {
-							node.apply_shoot_dealer_blank();
-						}
-					} break;
-					case Action::SHOOT_PLAYER: {
-						if (node.is_only_live_rounds() || node.round_known_live()) {
-							node.apply_shoot_player_live();
-							break;
-						}
-						if (node.is_only_blank_rounds() || node.round_known_blank()) {
-							node.apply_shoot_player_blank();
-							break;
-						}
-						bool is_live = prompt_is_live("[PROMPT] Dealer damaged the player (y/n): ");
-						if (is_live) {
-							node.apply_shoot_player_live();
-						}
-						else {
-							node.apply_shoot_player_blank();
-						}
-						break;
+				// The dealer never uses adrenaline.
+				std::vector<buckshot_action> dealer_available_actions = {BUCKSHOT_SHOOT_DEALER,
+				                                                         BUCKSHOT_SHOOT_PLAYER};
+				for (buckshot_action item_action :
+				     {BUCKSHOT_DRINK_BEER, BUCKSHOT_SMOKE_CIGARETTE, BUCKSHOT_USE_MAGNIFYING_GLASS,
+				      BUCKSHOT_USE_HANDSAW, BUCKSHOT_USE_HANDCUFFS, BUCKSHOT_USE_INVERTER,
+				      BUCKSHOT_USE_EXPIRED_MEDICINE, BUCKSHOT_USE_BURNER_PHONE}) {
+					// A cigarette pack does nothing at full health.
+					if (desc.dealer_items[get_item_kind(item_action)] > 0 &&
+					    (item_action != BUCKSHOT_SMOKE_CIGARETTE ||
+					     desc.dealer_lives < desc.max_lives)) {
+						dealer_available_actions.emplace_back(item_action);
 					}
-					case Action::DRINK_BEER: {
-						if (node.is_only_live_rounds() || node.round_known_live()) {
-							node.apply_drink_beer_live();
-							break;
-						}
-						if (node.is_only_blank_rounds() || node.round_known_blank()) {
-							node.apply_drink_beer_blank();
-							break;
-						}
-						bool is_live =
-						    prompt_is_live("[PROMPT] Dealer's beer ejected a live round (y/n): ");
-						if (is_live) {
-							node.apply_drink_beer_live();
-						}
-						else {
-							node.apply_drink_beer_blank();
-						}
-						break;
-					}
-					case Action::SMOKE_CIGARETTE:
-						node.apply_smoke_cigarette();
-						break;
-					case Action::USE_MAGNIFYING_GLASS: {
-						node.dealer_remove_magnifying_glass();
-						break;
-					}
-					case Action::USE_HANDSAW:
-						node.apply_use_handsaw();
-						break;
-					case Action::USE_HANDCUFFS:
-						node.apply_use_handcuffs();
-						break;
-					default:
-						assert(false);
 				}
+
+				action = prompt_action(dealer_available_actions);
+			}
+
+			const bool is_live =
+			    buckshot_action_needs_outcome(position, action) &&
+			    prompt_is_live(get_outcome_prompt(action, desc.is_dealer_turn));
+			if (buckshot_position_apply(&position, action, is_live) != BUCKSHOT_OK) {
+				std::cout << "[ERROR] The " << (desc.is_dealer_turn ? "dealer" : "player")
+				          << " cannot " << action_to_str(action) << " here.\n";
 			}
 		}
 	}
@@ -0,0 +1,126 @@
+#include "perft.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <string>
+
+#include "batch.hpp"
+
+namespace {
+// Counts the children of every expanded node by ply and expands them in turn, depth first.
+class TreeCounter final : public ChildVisitor {
+   public:
+	explicit TreeCounter(std::vector<uint64_t> &node_counts) : node_counts(node_counts) {}
+
+	float visit(const Node &child) override {
+		++this->node_counts[this->ply];
+		if (this->ply + 1 < this->node_counts.size()) {
+			++this->ply;
+			child.expand(*this);
+			--this->ply;
+		}
+		return 0.0f;
+	}
+
+	void visit_terminal(const Node &child) override {
+		(void)child;
+		++this->node_counts[this->ply];
+	}
+
+   private:
+	std::vector<uint64_t> &node_counts;
+	std::size_t ply = 0;
+};
+
+// Gathers the canonical keys of the children, with duplicates.
+class KeyCollector final : public ChildVisitor {
+   public:
+	float visit(const Node &child) override {
+		this->keys.push_back(child.get_canonical_key());
+		return 0.0f;
+	}
+
+	void visit_terminal(const Node &child) override {
+		this->keys.push_back(child.get_canonical_key());
+	}
+
+	std::vector<uint64_t> keys;
+};
+}  // namespace
+
+PerftResult run_perft(const Node &root, int max_plies) {
+	// Every ply uses up a shell or an item.
+	std::size_t ply_count = root.get_subtree_depth();
+	if (max_plies > 0) {
+		ply_count = std::min(ply_count, static_cast<std::size_t>(max_plies));
+	}
+
+	PerftResult result;
+	result.node_counts.assign(ply_count, 0);
+	result.state_counts.assign(ply_count, 0);
+	if (root.is_terminal() || ply_count == 0) {
+		return result;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	TreeCounter counter(result.node_counts);
+	root.expand(counter);
+	result.tree_time = std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	KeyCollector collector;
+	root.expand(collector);
+	for (std::size_t ply = 0; ply < ply_count; ++ply) {
+		std::vector<uint64_t> frontier = std::move(collector.keys);
+		std::sort(frontier.begin(), frontier.end());
+		frontier.erase(std::unique(frontier.begin(), frontier.end()), frontier.end());
+		result.state_counts[ply] = frontier.size();
+		collector.keys.clear();
+		if (ply + 1 < ply_count) {
+			for (uint64_t key : frontier) {
+				Node::from_key(key).expand(collector);
+			}
+		}
+	}
+	result.dag_time = std::chrono::steady_clock::now() - start;
+
+	while (!result.node_counts.empty() && result.node_counts.back() == 0) {
+		result.node_counts.pop_back();
+		result.state_counts.pop_back();
+	}
+	return result;
+}
+
+void run_perft_batch(std::istream &input, std::ostream &output, int max_plies) {
+	for (std::string line; std::getline(input, line);) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		std::string error;
+		const std::optional<Node> node = parse_position(line, error);
+		if (!node) {
+			output << "error " << error << '\n';
+			continue;
+		}
+		if (node->is_reload_pending()) {
+			output << "error campaign positions are not supported\n";
+			continue;
+		}
+
+		const PerftResult result = run_perft(*node, max_plies);
+		output << "perft " << line << '\n';
+		uint64_t node_count = 0;
+		uint64_t state_count = 0;
+		for (std::size_t ply = 0; ply < result.node_counts.size(); ++ply) {
+			output << "ply " << ply + 1 << ' ' << result.node_counts[ply] << ' '
+			       << result.state_counts[ply] << '\n';
+			node_count += result.node_counts[ply];
+			state_count += result.state_counts[ply];
+		}
+		const double seconds = std::chrono::duration<double>(result.tree_time).count();
+		output << "total " << node_count << ' ' << state_count << ' '
+		       << std::chrono::duration_cast<std::chrono::milliseconds>(result.tree_time).count()
+		       << ' ' << static_cast<uint64_t>(seconds > 0.0 ? node_count / seconds : 0.0) << '\n'
+		       << std::flush;
+	}
+}
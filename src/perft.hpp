@@ -0,0 +1,35 @@
+#ifndef PERFT_HPP
+#define PERFT_HPP
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "expectimax.hpp"
+
+// Counts the positions below a root ply by ply, with the successors the search generates
+// (Node::expand()): every player action and dealer move with every outcome of its chance nodes.
+// Terminal positions count at the ply they are reached at and are not expanded. The tree walk
+// counts every path, the DAG walk every distinct canonical state once per ply it is reached at.
+// Neither touches the evaluation, so the counts only change with the move generation and the state
+// layout.
+struct PerftResult {
+	std::vector<uint64_t> node_counts;   // tree nodes by ply, ply 1 first
+	std::vector<uint64_t> state_counts;  // distinct states by ply
+	std::chrono::nanoseconds tree_time{0};
+	std::chrono::nanoseconds dag_time{0};
+};
+
+// Walks at most max_plies plies below root, 0 walks to the end of the load. Campaign positions
+// are not supported, the end of their load is searched and not generated.
+PerftResult run_perft(const Node &root, int max_plies = 0);
+
+// Walks every position of a batch file (see src/batch.hpp) and writes
+//   perft <position>
+//   ply <n> <nodes> <states>      for every ply that has any positions
+//   total <nodes> <states> <ms> <nodes per second>
+// or "error <message>" if the line could not be used.
+void run_perft_batch(std::istream &input, std::ostream &output, int max_plies = 0);
+
+#endif  // PERFT_HPP
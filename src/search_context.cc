@@ -0,0 +1,77 @@
+#include "search_context.hpp"
+
+#include <algorithm>
+#include <utility>
+
+// Approximate size of a cached EV: its map node and bucket pointer.
+constexpr std::size_t CAMPAIGN_CACHE_ENTRY_SIZE = 32;
+
+static std::size_t get_max_entry_count(std::size_t size_mb) {
+	return (std::max<std::size_t>(size_mb, 1) << 20) / CAMPAIGN_CACHE_ENTRY_SIZE;
+}
+
+CampaignCache::CampaignCache(std::size_t size_mb) : max_entry_count(get_max_entry_count(size_mb)) {}
+
+std::optional<float> CampaignCache::get_ev(uint64_t key) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	const auto it = this->evs.find(key);
+	if (it == this->evs.end()) {
+		return std::nullopt;
+	}
+	return it->second;
+}
+
+void CampaignCache::add_ev(uint64_t key, float ev) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if (this->evs.size() >= this->max_entry_count) {
+		this->evs.clear();
+	}
+	this->evs.emplace(key, ev);
+}
+
+void CampaignCache::clear(void) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->evs.clear();
+}
+
+void CampaignCache::resize(std::size_t size_mb) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->max_entry_count = get_max_entry_count(size_mb);
+	if (this->evs.size() > this->max_entry_count) {
+		this->evs.clear();
+	}
+}
+
+SearchContext::SearchContext(std::size_t hash_size_mb, std::size_t thread_count)
+    : SearchContext(std::make_shared<TranspositionTableManager>(hash_size_mb),
+                    std::make_shared<CampaignCache>(hash_size_mb), thread_count) {}
+
+SearchContext::SearchContext(std::shared_ptr<TranspositionTableManager> table,
+                             std::shared_ptr<CampaignCache> campaign_cache,
+                             std::size_t thread_count)
+    : table(std::move(table)), campaign_cache(std::move(campaign_cache)) {
+	this->set_thread_count(thread_count);
+}
+
+void SearchContext::resize_caches(std::size_t hash_size_mb) {
+	this->table->resize(hash_size_mb);
+	this->campaign_cache->resize(hash_size_mb);
+}
+
+void SearchContext::set_thread_count(std::size_t thread_count) {
+	if (thread_count <= 1) {
+		this->scheduler.reset();
+	}
+	else if (!this->scheduler || this->scheduler->get_thread_count() != thread_count) {
+		this->scheduler = std::make_unique<TaskScheduler>(thread_count);
+	}
+}
+
+std::size_t SearchContext::get_thread_count(void) const {
+	return this->scheduler ? this->scheduler->get_thread_count() : 1;
+}
+
+SearchContext &get_default_search_context(void) {
+	static SearchContext context;
+	return context;
+}
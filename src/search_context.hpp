@@ -0,0 +1,88 @@
+#ifndef SEARCH_CONTEXT_HPP
+#define SEARCH_CONTEXT_HPP
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+#include "expectimax.hpp"
+#include "search_stats.hpp"
+#include "task_scheduler.hpp"
+#include "transposition_table.hpp"
+
+// Exact EVs of campaign positions: the reload chance nodes, by the state their load ends in, and
+// the loads dealt by them. Different ends of a load deal many of the same loads, and the search
+// below them is the bulk of the work, so these are kept for the whole run instead of competing for
+// transposition table slots. Only unbudgeted searches fill it.
+//
+// It takes at most about as much memory as the transposition table of its context. A full cache
+// starts over empty, which only costs the searches it would have saved.
+class CampaignCache final {
+   public:
+	explicit CampaignCache(std::size_t size_mb = TRANSPOSITION_TABLE_DEFAULT_SIZE_MB);
+
+	std::optional<float> get_ev(uint64_t key);
+	void add_ev(uint64_t key, float ev);
+	void clear(void);
+	// Clears the cache if it holds more than the new size allows.
+	void resize(std::size_t size_mb);
+
+   private:
+	std::mutex mutex;
+	std::unordered_map<uint64_t, float> evs;
+	std::size_t max_entry_count;
+};
+
+// Everything a search uses besides the position: the caches, the threads it is split across and
+// its counters. Searches on different contexts run concurrently without disturbing each other.
+// Contexts may share their caches, which are safe to use from several searches at once.
+//
+// The search reaches the context of the calling thread the way it reaches its SearchLimits: the
+// entry points in Node install it for their duration, and fork points hand it on to their tasks.
+class SearchContext final {
+   public:
+	explicit SearchContext(std::size_t hash_size_mb = TRANSPOSITION_TABLE_DEFAULT_SIZE_MB,
+	                       std::size_t thread_count = 1);
+	// Searches on the given caches, for example those of another context.
+	SearchContext(std::shared_ptr<TranspositionTableManager> table,
+	              std::shared_ptr<CampaignCache> campaign_cache, std::size_t thread_count = 1);
+
+	SearchContext(const SearchContext &) = delete;
+	SearchContext &operator=(const SearchContext &) = delete;
+
+	TranspositionTableManager &get_table(void) const { return *this->table; }
+	CampaignCache &get_campaign_cache(void) const { return *this->campaign_cache; }
+	// Resizes the transposition table and with it the bound of the campaign cache.
+	void resize_caches(std::size_t hash_size_mb);
+	const std::shared_ptr<TranspositionTableManager> &get_shared_table(void) const {
+		return this->table;
+	}
+	const std::shared_ptr<CampaignCache> &get_shared_campaign_cache(void) const {
+		return this->campaign_cache;
+	}
+
+	// Number of threads searches run on (1 searches on the caller only). Only change it between
+	// searches.
+	void set_thread_count(std::size_t thread_count);
+	std::size_t get_thread_count(void) const;
+	// Null when searching on the caller only.
+	TaskScheduler *get_scheduler(void) const { return this->scheduler.get(); }
+	// Subtrees with at least this many shells and items left are split into parallel tasks.
+	void set_parallel_cutoff(int subtree_depth) { this->parallel_cutoff = subtree_depth; }
+	int get_parallel_cutoff(void) const { return this->parallel_cutoff; }
+
+	SearchCounterSet &get_counters(void) { return this->counters; }
+	SearchStats collect_stats(void) const { return this->counters.collect(); }
+	void reset_stats(void) { this->counters.reset(); }
+
+   private:
+	std::shared_ptr<TranspositionTableManager> table;
+	std::shared_ptr<CampaignCache> campaign_cache;
+	std::unique_ptr<TaskScheduler> scheduler;
+	int parallel_cutoff = DEFAULT_PARALLEL_CUTOFF;
+	SearchCounterSet counters;
+};
+
+#endif  // SEARCH_CONTEXT_HPP
@@ -0,0 +1,154 @@
+#include "search_stats.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+struct SearchCounterBlocks {
+	std::mutex mutex;
+	std::vector<std::unique_ptr<SearchCounters>> blocks;
+	std::vector<SearchCounters *> free_blocks;  // blocks of threads that have exited
+};
+
+namespace {
+SearchStats read_counters(const SearchCounters &counters) {
+	SearchStats stats;
+	stats.nodes = counters.nodes.load(std::memory_order_relaxed);
+	stats.terminal_evals = counters.terminal_evals.load(std::memory_order_relaxed);
+	stats.dealer_nodes = counters.dealer_nodes.load(std::memory_order_relaxed);
+	stats.player_nodes = counters.player_nodes.load(std::memory_order_relaxed);
+	stats.reload_nodes = counters.reload_nodes.load(std::memory_order_relaxed);
+	stats.tt_probes = counters.tt_probes.load(std::memory_order_relaxed);
+	stats.tt_hits = counters.tt_hits.load(std::memory_order_relaxed);
+	stats.tt_stores = counters.tt_stores.load(std::memory_order_relaxed);
+	stats.tt_evictions = counters.tt_evictions.load(std::memory_order_relaxed);
+	stats.max_depth = counters.max_depth.load(std::memory_order_relaxed);
+	for (int i = 0; i < ACTION_COUNT; ++i) {
+		stats.root_action_ns[i] = counters.root_action_ns[i].load(std::memory_order_relaxed);
+	}
+	return stats;
+}
+
+void clear_counters(SearchCounters &counters) {
+	counters.nodes.store(0, std::memory_order_relaxed);
+	counters.terminal_evals.store(0, std::memory_order_relaxed);
+	counters.dealer_nodes.store(0, std::memory_order_relaxed);
+	counters.player_nodes.store(0, std::memory_order_relaxed);
+	counters.reload_nodes.store(0, std::memory_order_relaxed);
+	counters.tt_probes.store(0, std::memory_order_relaxed);
+	counters.tt_hits.store(0, std::memory_order_relaxed);
+	counters.tt_stores.store(0, std::memory_order_relaxed);
+	counters.tt_evictions.store(0, std::memory_order_relaxed);
+	counters.max_depth.store(0, std::memory_order_relaxed);
+	for (std::atomic<uint64_t> &root_action_ns : counters.root_action_ns) {
+		root_action_ns.store(0, std::memory_order_relaxed);
+	}
+}
+
+struct ThreadBlock {
+	uint64_t set_id;
+	std::weak_ptr<SearchCounterBlocks> blocks;
+	SearchCounters *counters;
+};
+
+// The blocks the calling thread holds, handed back to the sets still alive when it exits.
+struct ThreadBlocks {
+	std::vector<ThreadBlock> entries;
+
+	~ThreadBlocks(void) {
+		for (const ThreadBlock &entry : this->entries) {
+			if (std::shared_ptr<SearchCounterBlocks> blocks = entry.blocks.lock()) {
+				std::lock_guard<std::mutex> lock(blocks->mutex);
+				blocks->free_blocks.push_back(entry.counters);
+			}
+		}
+	}
+};
+}  // namespace
+
+SearchStats &SearchStats::operator+=(const SearchStats &other) {
+	this->nodes += other.nodes;
+	this->terminal_evals += other.terminal_evals;
+	this->dealer_nodes += other.dealer_nodes;
+	this->player_nodes += other.player_nodes;
+	this->reload_nodes += other.reload_nodes;
+	this->tt_probes += other.tt_probes;
+	this->tt_hits += other.tt_hits;
+	this->tt_stores += other.tt_stores;
+	this->tt_evictions += other.tt_evictions;
+	this->max_depth = std::max(this->max_depth, other.max_depth);
+	for (int i = 0; i < ACTION_COUNT; ++i) {
+		this->root_action_ns[i] += other.root_action_ns[i];
+	}
+	return *this;
+}
+
+SearchCounterSet::SearchCounterSet(void) : blocks(std::make_shared<SearchCounterBlocks>()) {
+	static std::atomic<uint64_t> next_id{1};
+	this->id = next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+SearchCounters &SearchCounterSet::get_thread_counters(void) {
+	// Ids are never reused, so the block of a set destroyed since cannot match.
+	thread_local ThreadBlocks thread_blocks;
+	std::vector<ThreadBlock> &entries = thread_blocks.entries;
+	for (const ThreadBlock &entry : entries) {
+		if (entry.set_id == this->id) {
+			return *entry.counters;
+		}
+	}
+	entries.erase(std::remove_if(entries.begin(), entries.end(),
+	                             [](const ThreadBlock &entry) { return entry.blocks.expired(); }),
+	              entries.end());
+
+	std::lock_guard<std::mutex> lock(this->blocks->mutex);
+	SearchCounters *counters;
+	if (this->blocks->free_blocks.empty()) {
+		this->blocks->blocks.push_back(std::make_unique<SearchCounters>());
+		counters = this->blocks->blocks.back().get();
+	}
+	else {
+		counters = this->blocks->free_blocks.back();
+		this->blocks->free_blocks.pop_back();
+	}
+	entries.push_back(ThreadBlock{this->id, this->blocks, counters});
+	return *counters;
+}
+
+SearchStats SearchCounterSet::collect(void) const {
+	std::lock_guard<std::mutex> lock(this->blocks->mutex);
+	SearchStats stats;
+	for (const std::unique_ptr<SearchCounters> &counters : this->blocks->blocks) {
+		stats += read_counters(*counters);
+	}
+	return stats;
+}
+
+void SearchCounterSet::reset(void) {
+	std::lock_guard<std::mutex> lock(this->blocks->mutex);
+	for (const std::unique_ptr<SearchCounters> &counters : this->blocks->blocks) {
+		clear_counters(*counters);
+	}
+}
+
+void print_search_stats(std::ostream &output, const SearchStats &stats) {
+	if constexpr (!SEARCH_STATS_ENABLED) {
+		output << "[STATS] Search statistics were compiled out (BUCKSHOT_SEARCH_STATS is off).\n";
+		return;
+	}
+
+	const double hit_rate =
+	    stats.tt_probes > 0 ? 100.0 * stats.tt_hits / static_cast<double>(stats.tt_probes) : 0.0;
+	output << "[STATS] Nodes: " << stats.nodes << " (" << stats.player_nodes << " player, "
+	       << stats.dealer_nodes << " dealer, " << stats.reload_nodes << " reload, "
+	       << stats.terminal_evals << " terminal), max depth: " << stats.max_depth << ".\n"
+	       << "[STATS] TT: " << stats.tt_probes << " probes, " << stats.tt_hits << " hits ("
+	       << hit_rate << "%), " << stats.tt_stores << " stores, " << stats.tt_evictions
+	       << " evictions.\n";
+	for (int i = 0; i < ACTION_COUNT; ++i) {
+		if (stats.root_action_ns[i] > 0) {
+			output << "[STATS] Root action '" << get_action_name(static_cast<Action>(i))
+			       << "': " << stats.root_action_ns[i] / 1'000'000.0 << " ms.\n";
+		}
+	}
+}
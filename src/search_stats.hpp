@@ -0,0 +1,112 @@
+#ifndef SEARCH_STATS_HPP
+#define SEARCH_STATS_HPP
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+#include "expectimax.hpp"
+
+// Counting is compiled in with -DBUCKSHOT_SEARCH_STATS (the BUCKSHOT_SEARCH_STATS CMake option).
+// Without it every counting call below is an empty inline function and all stats read as zero.
+#ifdef BUCKSHOT_SEARCH_STATS
+constexpr bool SEARCH_STATS_ENABLED = true;
+#else
+constexpr bool SEARCH_STATS_ENABLED = false;
+#endif
+
+struct SearchStats {
+	uint64_t nodes = 0;  // expectimax calls, including terminal positions and TT hits
+	uint64_t terminal_evals = 0;
+	uint64_t dealer_nodes = 0;  // expanded positions (not terminal, not in the TT)
+	uint64_t player_nodes = 0;
+	uint64_t reload_nodes = 0;  // campaign reloads searched (not cached)
+	uint64_t tt_probes = 0;
+	uint64_t tt_hits = 0;
+	uint64_t tt_stores = 0;
+	uint64_t tt_evictions = 0;  // stores that overwrote another position
+	uint64_t max_depth = 0;     // in plies below the searched position
+	uint64_t root_action_ns[ACTION_COUNT] = {};
+
+	SearchStats &operator+=(const SearchStats &other);
+};
+
+// Every thread counts into its own block, so the hot path never contends on a shared cache line.
+// The atomics are only there so SearchCounterSet::collect() may read them while searches are
+// running; increments are plain loads and stores.
+struct SearchCounters {
+	std::atomic<uint64_t> nodes{0};
+	std::atomic<uint64_t> terminal_evals{0};
+	std::atomic<uint64_t> dealer_nodes{0};
+	std::atomic<uint64_t> player_nodes{0};
+	std::atomic<uint64_t> reload_nodes{0};
+	std::atomic<uint64_t> tt_probes{0};
+	std::atomic<uint64_t> tt_hits{0};
+	std::atomic<uint64_t> tt_stores{0};
+	std::atomic<uint64_t> tt_evictions{0};
+	std::atomic<uint64_t> max_depth{0};
+	std::atomic<uint64_t> root_action_ns[ACTION_COUNT] = {};
+};
+
+struct SearchCounterBlocks;
+
+// The counters of one SearchContext. Every thread searching on it counts into a block of its own,
+// which goes back to the set when the thread exits and is handed to the next new thread. Blocks
+// keep their counts, so there are only as many as threads that searched on the set at once.
+class SearchCounterSet final {
+   public:
+	SearchCounterSet(void);
+
+	SearchCounterSet(const SearchCounterSet &) = delete;
+	SearchCounterSet &operator=(const SearchCounterSet &) = delete;
+
+	// Block of the calling thread, taken on first use.
+	SearchCounters &get_thread_counters(void);
+	// Sums the blocks of all threads. max_depth is the maximum over all threads.
+	SearchStats collect(void) const;
+	void reset(void);
+
+   private:
+	uint64_t id;
+	// Shared with the threads holding a block, which may exit after the set is gone.
+	std::shared_ptr<SearchCounterBlocks> blocks;
+};
+
+// Block the calling thread counts into, set for the duration of a search by the SearchContext it
+// runs on. Nothing is counted outside of a search.
+inline thread_local SearchCounters *current_search_counters = nullptr;
+
+inline void add_to_counter(std::atomic<uint64_t> &counter, uint64_t value) {
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+inline void count_search_stat(std::atomic<uint64_t> SearchCounters::*counter) {
+	if constexpr (SEARCH_STATS_ENABLED) {
+		if (SearchCounters *counters = current_search_counters) {
+			add_to_counter(counters->*counter, 1);
+		}
+	}
+}
+
+inline void count_search_depth(int depth) {
+	if constexpr (SEARCH_STATS_ENABLED) {
+		if (SearchCounters *counters = current_search_counters) {
+			std::atomic<uint64_t> &max_depth = counters->max_depth;
+			if (static_cast<uint64_t>(depth) > max_depth.load(std::memory_order_relaxed)) {
+				max_depth.store(depth, std::memory_order_relaxed);
+			}
+		}
+	}
+}
+
+inline void count_root_action_time(Action action, uint64_t nanoseconds) {
+	if constexpr (SEARCH_STATS_ENABLED) {
+		if (SearchCounters *counters = current_search_counters) {
+			add_to_counter(counters->root_action_ns[static_cast<int>(action)], nanoseconds);
+		}
+	}
+}
+
+void print_search_stats(std::ostream &output, const SearchStats &stats);
+
+#endif  // SEARCH_STATS_HPP
@@ -0,0 +1,203 @@
+#include "server.hpp"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batch.hpp"
+#include "search_context.hpp"
+
+static std::atomic<int> connection_count{0};
+
+namespace {
+// Accepted connections waiting for a free worker.
+class ConnectionQueue final {
+   public:
+	void push(int fd) {
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->fds.push_back(fd);
+		}
+		this->ready.notify_one();
+	}
+
+	int pop(void) {
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->ready.wait(lock, [this] { return !this->fds.empty(); });
+		const int fd = this->fds.front();
+		this->fds.pop_front();
+		return fd;
+	}
+
+   private:
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::deque<int> fds;
+};
+}  // namespace
+
+static bool send_all(int fd, const std::string &data) {
+	std::size_t sent = 0;
+	while (sent < data.size()) {
+		const ssize_t written = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+		if (written <= 0) {
+			return false;
+		}
+		sent += written;
+	}
+	return true;
+}
+
+static std::string answer_query(const std::string &line, const SearchBudget &budget,
+                                SearchContext &context) {
+	const auto start_time = std::chrono::steady_clock::now();
+
+	std::string error;
+	std::optional<Node> node = parse_position(line, error);
+	if (!node) {
+		return "error " + error + '\n';
+	}
+
+	const std::string result = solve_position(*node, budget, false, context);
+	const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+	    std::chrono::steady_clock::now() - start_time);
+	return result + ' ' + std::to_string(latency.count()) + '\n';
+}
+
+static void serve_connection(int fd, const SearchBudget &budget, SearchContext &context) {
+	const int connection_id = ++connection_count;
+	std::cerr << "[INFO] Client " << connection_id << " connected.\n";
+
+	timeval timeout{};
+	timeout.tv_sec = SERVER_IDLE_TIMEOUT.count();
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	std::string buffer;
+	char chunk[4096];
+	for (;;) {
+		const ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+		if (received < 0 && errno == EINTR) {
+			continue;
+		}
+		if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			std::cerr << "[INFO] Client " << connection_id << " timed out.\n";
+			break;
+		}
+		if (received <= 0) {
+			break;
+		}
+		buffer.append(chunk, received);
+
+		std::size_t line_end;
+		while ((line_end = buffer.find('\n')) != std::string::npos) {
+			std::string line = buffer.substr(0, line_end);
+			buffer.erase(0, line_end + 1);
+			if (!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+			if (line.empty() || line[0] == '#') {
+				continue;
+			}
+			if (!send_all(fd, answer_query(line, budget, context))) {
+				close(fd);
+				std::cerr << "[INFO] Client " << connection_id << " disconnected.\n";
+				return;
+			}
+		}
+	}
+
+	close(fd);
+	std::cerr << "[INFO] Client " << connection_id << " disconnected.\n";
+}
+
+int run_server(const std::string &socket_path, const SearchBudget &budget) {
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (socket_path.size() >= sizeof(address.sun_path)) {
+		std::cerr << "[ERROR] Socket path '" << socket_path << "' is too long.\n";
+		return 1;
+	}
+	std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+	// A socket left behind by an earlier run would make bind() fail. Anything else at that path is
+	// left alone.
+	struct stat path_stat;
+	if (lstat(socket_path.c_str(), &path_stat) == 0 && S_ISSOCK(path_stat.st_mode)) {
+		unlink(socket_path.c_str());
+	}
+
+	const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd < 0) {
+		std::cerr << "[ERROR] Could not create socket: " << std::strerror(errno) << ".\n";
+		return 1;
+	}
+	if (bind(listen_fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+	    listen(listen_fd, SOMAXCONN) != 0) {
+		std::cerr << "[ERROR] Could not listen on '" << socket_path
+		          << "': " << std::strerror(errno) << ".\n";
+		close(listen_fd);
+		return 1;
+	}
+
+	// Every worker has a context of its own for its threads and counters, searching on the table
+	// and campaign cache of the default context. A query that ages the table only marks the entries
+	// of the others as the first to go, as their EVs stay valid.
+	const SearchContext &defaults = get_default_search_context();
+	std::vector<std::unique_ptr<SearchContext>> contexts;
+	try {
+		for (int i = 0; i < SERVER_WORKER_COUNT; ++i) {
+			contexts.push_back(std::make_unique<SearchContext>(defaults.get_shared_table(),
+			                                                   defaults.get_shared_campaign_cache(),
+			                                                   defaults.get_thread_count()));
+			contexts.back()->set_parallel_cutoff(defaults.get_parallel_cutoff());
+		}
+	}
+	catch (const std::bad_alloc &) {
+		std::cerr << "[ERROR] Out of memory.\n";
+		close(listen_fd);
+		return 1;
+	}
+
+	ConnectionQueue queue;
+	std::vector<std::thread> workers;
+	for (const std::unique_ptr<SearchContext> &context : contexts) {
+		workers.emplace_back([&queue, &budget, &context] {
+			for (;;) {
+				serve_connection(queue.pop(), budget, *context);
+			}
+		});
+	}
+
+	std::cerr << "[INFO] Listening on '" << socket_path << "' with " << SERVER_WORKER_COUNT
+	          << " workers.\n";
+	for (;;) {
+		const int client_fd = accept(listen_fd, nullptr, nullptr);
+		if (client_fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			std::cerr << "[ERROR] accept() failed: " << std::strerror(errno) << ".\n";
+			close(listen_fd);
+			// The workers never return, so they cannot be joined.
+			std::exit(1);
+		}
+		queue.push(client_fd);
+	}
+}
@@ -0,0 +1,26 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+#include <chrono>
+#include <string>
+
+#include "expectimax.hpp"
+
+// Connections served at once. Further clients wait until a worker is free.
+constexpr int SERVER_WORKER_COUNT = 4;
+// A client that sends nothing for this long is disconnected, handing its worker to the next one.
+constexpr std::chrono::seconds SERVER_IDLE_TIMEOUT{30};
+
+/*
+ * Keeps the solver resident and answers position queries on a Unix domain socket. Clients send
+ * positions in the batch format (see batch.hpp), one per line, and get one line back per position:
+ * "<action> <ev> <latency in microseconds>" or "error <message>". A fixed pool of workers serves
+ * one connection each, and every worker searches on the transposition table of the default context,
+ * which stays warm across clients. Each query starts one new table generation. With a search
+ * budget every position is answered within it, and "exact" or "truncated" goes before the latency
+ * as in batch mode.
+ *
+ * Returns a non-zero exit code if the socket could not be set up, otherwise it serves forever.
+ */
+int run_server(const std::string &socket_path, const SearchBudget &budget = SearchBudget{});
+
+#endif  // SERVER_HPP
@@ -0,0 +1,485 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "expectimax.hpp"
+#include "item_manager.hpp"
+#include "search_context.hpp"
+#include "transposition_table.hpp"
+
+struct Args {
+	bool should_output_help = false;
+	int games_per_round = 1000;
+	int round = 0;  // 0 plays every round
+	uint64_t seed = 1;
+	std::size_t hash_size_mb = TRANSPOSITION_TABLE_DEFAULT_SIZE_MB;
+	std::size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+	bool is_double_or_nothing = false;
+	bool is_budget_set = false;
+	SearchBudget budget;
+};
+
+// A round of normal mode: both sides start at max_lives, and every load of the shotgun hands each
+// of them items_per_load random classic items. Double or nothing keeps the lives, but deals 1 to
+// items_per_load items of all kinds instead.
+struct RoundConfig {
+	int max_lives;
+	int items_per_load;
+	bool is_double_or_nothing = false;
+};
+
+constexpr std::array<RoundConfig, 3> ROUND_CONFIGS = {{{2, 0}, {4, 2}, {6, 4}}};
+constexpr int MAX_SHELL_COUNT = 8;
+
+struct GameResult {
+	bool player_won;
+	int load_count;
+	int player_action_count;
+};
+
+struct RoundResult {
+	uint64_t game_count = 0;
+	uint64_t win_count = 0;
+	uint64_t load_count = 0;
+	uint64_t player_action_count = 0;
+
+	RoundResult &operator+=(const RoundResult &other) {
+		this->game_count += other.game_count;
+		this->win_count += other.win_count;
+		this->load_count += other.load_count;
+		this->player_action_count += other.player_action_count;
+		return *this;
+	}
+};
+
+void print_help(void) {
+	std::cout << "Usage: buckshot-roulette-sim [FLAGS]\n"
+	          << "Plays full rounds of normal mode with the solver's best action against the\n"
+	          << "dealer AI and prints one JSON object per round with the win rate, followed by a\n"
+	          << "summary.\n"
+	          << "  --help, --h        : Print this help message.\n"
+	          << "  --games <N>        : Games to play per round (default 1000).\n"
+	          << "  --round <N>        : Only play round N, 1-3 (default all).\n"
+	          << "  --seed <N>         : Seed of the random loads and item draws (default 1).\n"
+	          << "  --hash <MB>        : Size of the transposition table in megabytes (default "
+	          << TRANSPOSITION_TABLE_DEFAULT_SIZE_MB << ").\n"
+	          << "  --threads <N>      : Play games on N threads (default all cores).\n"
+	          << "  --movetime <MS>    : Give every player decision MS milliseconds (default\n"
+	          << "                       exact).\n"
+	          << "  --nodes <N>        : Same with a budget of about N searched nodes.\n"
+	          << "  --double-or-nothing: Deal the loads of double or nothing, and give every\n"
+	          << "                       player decision "
+	          << DOUBLE_OR_NOTHING_DEFAULT_MOVETIME.count()
+	          << " ms unless a budget is set.\n";
+}
+
+Args parse_cmd_args(int argc, char **argv) {
+	Args args;
+	for (int i = 1; i < argc; ++i) {
+		std::string curr = argv[i];
+		if (curr == "--h" || curr == "--help") {
+			args.should_output_help = true;
+			continue;
+		}
+		if (curr == "--double-or-nothing") {
+			args.is_double_or_nothing = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			std::cerr << "[WARNING] Ignoring command line argument '" << curr << "'.\n";
+			continue;
+		}
+
+		try {
+			if (curr == "--games") {
+				args.games_per_round = std::max(1, std::stoi(argv[++i]));
+			}
+			else if (curr == "--round") {
+				args.round = std::stoi(argv[++i]);
+			}
+			else if (curr == "--seed") {
+				args.seed = std::stoull(argv[++i]);
+			}
+			else if (curr == "--hash") {
+				args.hash_size_mb = std::stoul(argv[++i]);
+			}
+			else if (curr == "--threads") {
+				args.thread_count = std::max<std::size_t>(1, std::stoul(argv[++i]));
+			}
+			else if (curr == "--movetime") {
+				args.budget.time = std::chrono::milliseconds(std::stoll(argv[++i]));
+				args.is_budget_set = true;
+			}
+			else if (curr == "--nodes") {
+				args.budget.nodes = std::stoull(argv[++i]);
+				args.is_budget_set = true;
+			}
+			else {
+				std::cerr << "[WARNING] Ignoring command line argument '" << curr << "'.\n";
+			}
+		}
+		catch (const std::exception &) {
+			std::cerr << "[WARNING] Invalid value '" << argv[i] << "' for " << curr
+			          << ", using default.\n";
+		}
+	}
+	if (args.is_double_or_nothing && !args.is_budget_set) {
+		args.budget.time = DOUBLE_OR_NOTHING_DEFAULT_MOVETIME;
+	}
+	return args;
+}
+
+// Deals count random items of the first kind_count kinds. Items beyond a full table are lost, like
+// those of a later kind the node cannot hold more of.
+static ItemManager grant_items(ItemManager items, int count, int kind_count, std::mt19937_64 &rng) {
+	std::array<int, ITEM_KIND_COUNT> counts = {
+	    items.get_count<ItemKind::MAGNIFYING_GLASS>(), items.get_count<ItemKind::CIGARETTE_PACK>(),
+	    items.get_count<ItemKind::BEER>(), items.get_count<ItemKind::HANDSAW>(),
+	    items.get_count<ItemKind::HANDCUFFS>(), items.get_count<ItemKind::ADRENALINE>(),
+	    items.get_count<ItemKind::INVERTER>(), items.get_count<ItemKind::EXPIRED_MEDICINE>(),
+	    items.get_count<ItemKind::BURNER_PHONE>()};
+	std::uniform_int_distribution<int> kind_distribution(0, kind_count - 1);
+	for (int i = 0; i < count && items.get_item_count() + i < MAX_HELD_ITEM_COUNT; ++i) {
+		const int kind = kind_distribution(rng);
+		counts[kind] = std::min(counts[kind] + 1, get_max_item_kind_count(kind));
+	}
+	return ItemManager(counts[0], counts[1], counts[2], counts[3], counts[4], counts[5], counts[6],
+	                   counts[7], counts[8]);
+}
+
+static ItemManager grant_load_items(const RoundConfig &config, ItemManager items,
+                                    std::mt19937_64 &rng) {
+	if (config.is_double_or_nothing) {
+		const int count = std::uniform_int_distribution<int>(1, config.items_per_load)(rng);
+		return grant_items(items, count, ITEM_KIND_COUNT, rng);
+	}
+	return grant_items(items, config.items_per_load, CLASSIC_ITEM_KIND_COUNT, rng);
+}
+
+// Loads 2-8 shells with at least one of each type in random order, and hands out the items of the
+// load. The player shoots first after every load.
+static Node load_shotgun(const RoundConfig &config, int dealer_lives, int player_lives,
+                         ItemManager dealer_items, ItemManager player_items,
+                         std::vector<bool> &shells, std::mt19937_64 &rng) {
+	const int shell_count = std::uniform_int_distribution<int>(2, MAX_SHELL_COUNT)(rng);
+	const int live_round_count = std::uniform_int_distribution<int>(1, shell_count - 1)(rng);
+	shells.assign(shell_count, false);
+	std::fill(shells.begin(), shells.begin() + live_round_count, true);
+	std::shuffle(shells.begin(), shells.end(), rng);
+
+	return Node(false, false, false, live_round_count, shell_count - live_round_count,
+	            config.max_lives, dealer_lives, player_lives,
+	            grant_load_items(config, dealer_items, rng),
+	            grant_load_items(config, player_items, rng));
+}
+
+// shell is the current round as it is counted, which is kept in step when the player inverts it.
+static void play_player_action(Node &node, Action action, std::vector<bool>::reference shell,
+                               std::mt19937_64 &rng) {
+	const bool is_live = shell;
+	switch (action) {
+		case Action::SHOOT_DEALER:
+			is_live ? node.apply_shoot_dealer_live() : node.apply_shoot_dealer_blank();
+			break;
+		case Action::SHOOT_PLAYER:
+			is_live ? node.apply_shoot_player_live() : node.apply_shoot_player_blank();
+			break;
+		case Action::DRINK_BEER:
+			is_live ? node.apply_drink_beer_live() : node.apply_drink_beer_blank();
+			break;
+		case Action::SMOKE_CIGARETTE:
+			node.apply_smoke_cigarette();
+			break;
+		case Action::USE_MAGNIFYING_GLASS:
+		case Action::USE_BURNER_PHONE: {
+			// Revealing an inverted round counts it as the type it hits as.
+			const bool was_inverted = node.is_round_inverted();
+			if (action == Action::USE_MAGNIFYING_GLASS) {
+				is_live ? node.apply_magnify_live() : node.apply_magnify_blank();
+			}
+			else {
+				is_live ? node.apply_burner_phone_live() : node.apply_burner_phone_blank();
+			}
+			shell = is_live != was_inverted;
+			break;
+		}
+		case Action::USE_HANDSAW:
+			node.apply_use_handsaw();
+			break;
+		case Action::USE_HANDCUFFS:
+			node.apply_use_handcuffs();
+			break;
+		case Action::USE_ADRENALINE:
+			node.apply_use_adrenaline();
+			break;
+		case Action::USE_INVERTER: {
+			// A known round moves to the other count, an unknown one only gets marked.
+			const bool was_inverted = node.is_round_inverted();
+			node.apply_use_inverter();
+			if (node.is_round_inverted() == was_inverted) {
+				shell = !is_live;
+			}
+			break;
+		}
+		case Action::USE_EXPIRED_MEDICINE:
+			if (std::bernoulli_distribution(0.4)(rng)) {
+				node.apply_expired_medicine_heal();
+			}
+			else {
+				node.apply_expired_medicine_damage();
+			}
+			break;
+	}
+}
+
+// The dealer AI of the comment in Node::dealer_expectimax, with its items in a random spawn order:
+// it uses the first item it wants and shoots once it wants none of them. Like the model, it never
+// picks adrenaline or the burner phone. shell is kept in step as in play_player_action().
+static void play_dealer_action(Node &node, std::vector<bool>::reference shell,
+                               std::mt19937_64 &rng) {
+	const bool is_live = shell;
+	const ItemManager items = node.get_dealer_items();
+	const bool is_last_round = node.get_live_round_count() + node.get_blank_round_count() == 1;
+	const bool knows_live =
+	    node.round_known_live() || (is_last_round && node.get_live_round_count() == 1);
+	const bool knows_blank =
+	    node.round_known_blank() || (is_last_round && node.get_blank_round_count() == 1);
+
+	std::vector<ItemKind> spawn_order;
+	for (int i = 0; i < items.get_count<ItemKind::MAGNIFYING_GLASS>(); ++i) {
+		spawn_order.push_back(ItemKind::MAGNIFYING_GLASS);
+	}
+	for (int i = 0; i < items.get_count<ItemKind::CIGARETTE_PACK>(); ++i) {
+		spawn_order.push_back(ItemKind::CIGARETTE_PACK);
+	}
+	for (int i = 0; i < items.get_count<ItemKind::BEER>(); ++i) {
+		spawn_order.push_back(ItemKind::BEER);
+	}
+	for (int i = 0; i < items.get_count<ItemKind::HANDSAW>(); ++i) {
+		spawn_order.push_back(ItemKind::HANDSAW);
+	}
+	for (int i = 0; i < items.get_count<ItemKind::HANDCUFFS>(); ++i) {
+		spawn_order.push_back(ItemKind::HANDCUFFS);
+	}
+	for (int i = 0; i < items.get_count<ItemKind::INVERTER>(); ++i) {
+		spawn_order.push_back(ItemKind::INVERTER);
+	}
+	for (int i = 0; i < items.get_count<ItemKind::EXPIRED_MEDICINE>(); ++i) {
+		spawn_order.push_back(ItemKind::EXPIRED_MEDICINE);
+	}
+	std::shuffle(spawn_order.begin(), spawn_order.end(), rng);
+
+	for (ItemKind kind : spawn_order) {
+		switch (kind) {
+			case ItemKind::BEER:
+				if (!node.round_known_live() && !is_last_round) {
+					is_live ? node.apply_drink_beer_live() : node.apply_drink_beer_blank();
+					return;
+				}
+				break;
+			case ItemKind::CIGARETTE_PACK:
+				if (node.get_dealer_lives() != node.get_max_lives()) {
+					node.apply_smoke_cigarette();
+					return;
+				}
+				break;
+			case ItemKind::MAGNIFYING_GLASS:
+				if (!node.round_known_live() && !node.round_known_blank() && !is_last_round) {
+					is_live ? node.apply_magnify_live() : node.apply_magnify_blank();
+					return;
+				}
+				break;
+			case ItemKind::HANDSAW:
+				if (!node.is_handsaw_applied() && node.round_known_live()) {
+					node.apply_use_handsaw();
+					return;
+				}
+				break;
+			case ItemKind::HANDCUFFS:
+				if (node.is_handcuffs_available() && !node.is_handcuffs_applied() &&
+				    !is_last_round) {
+					node.apply_use_handcuffs();
+					return;
+				}
+				break;
+			case ItemKind::INVERTER:
+				// Only known rounds, which move to the other count.
+				if (node.round_known_blank() || node.is_only_blank_rounds()) {
+					node.apply_use_inverter();
+					shell = !is_live;
+					return;
+				}
+				break;
+			case ItemKind::EXPIRED_MEDICINE:
+				if (node.get_dealer_lives() != node.get_max_lives() &&
+				    node.get_dealer_lives() > (node.get_max_lives() == 6 ? 2 : 1)) {
+					if (std::bernoulli_distribution(0.4)(rng)) {
+						node.apply_expired_medicine_heal();
+					}
+					else {
+						node.apply_expired_medicine_damage();
+					}
+					return;
+				}
+				break;
+			default:
+				break;
+		}
+	}
+
+	const bool shoots_player =
+	    knows_live || (!knows_blank && std::bernoulli_distribution(0.5)(rng));
+	if (shoots_player) {
+		is_live ? node.apply_shoot_player_live() : node.apply_shoot_player_blank();
+	}
+	else {
+		is_live ? node.apply_shoot_dealer_live() : node.apply_shoot_dealer_blank();
+	}
+}
+
+static GameResult play_game(const RoundConfig &config, const SearchBudget &budget,
+                            std::mt19937_64 &rng) {
+	GameResult result{false, 1, 0};
+	std::vector<bool> shells;
+	std::size_t shell_index = 0;
+	Node node = load_shotgun(config, config.max_lives, config.max_lives, ItemManager(),
+	                         ItemManager(), shells, rng);
+
+	while (node.get_dealer_lives() > 0 && node.get_player_lives() > 0) {
+		if (shell_index == shells.size()) {
+			node = load_shotgun(config, node.get_dealer_lives(), node.get_player_lives(),
+			                    node.get_dealer_items(), node.get_player_items(), shells, rng);
+			shell_index = 0;
+			result.load_count++;
+			continue;
+		}
+
+		// Only shots and beers use up the shell.
+		const int shell_count = node.get_live_round_count() + node.get_blank_round_count();
+		if (node.is_dealer_turn()) {
+			play_dealer_action(node, shells[shell_index], rng);
+		}
+		else {
+			const Action action = node.get_best_action(budget).action;
+			play_player_action(node, action, shells[shell_index], rng);
+			result.player_action_count++;
+		}
+		if (node.get_live_round_count() + node.get_blank_round_count() < shell_count) {
+			shell_index++;
+		}
+	}
+
+	result.player_won = node.get_dealer_lives() == 0;
+	return result;
+}
+
+// Every thread plays every thread_count-th game on its own random stream, so a run is reproducible
+// for a given seed and thread count.
+static RoundResult play_round(const RoundConfig &config, int round_index, const Args &args) {
+	std::vector<RoundResult> thread_results(args.thread_count);
+	std::vector<std::thread> threads;
+	for (std::size_t thread_index = 0; thread_index < args.thread_count; ++thread_index) {
+		threads.emplace_back([&, thread_index] {
+			std::seed_seq seed{static_cast<uint32_t>(args.seed),
+			                   static_cast<uint32_t>(args.seed >> 32),
+			                   static_cast<uint32_t>(round_index),
+			                   static_cast<uint32_t>(thread_index)};
+			std::mt19937_64 rng(seed);
+			RoundResult &thread_result = thread_results[thread_index];
+			const std::size_t game_count = args.games_per_round;
+			for (std::size_t game = thread_index; game < game_count; game += args.thread_count) {
+				const GameResult game_result = play_game(config, args.budget, rng);
+				thread_result.game_count++;
+				thread_result.win_count += game_result.player_won;
+				thread_result.load_count += game_result.load_count;
+				thread_result.player_action_count += game_result.player_action_count;
+			}
+		});
+	}
+
+	RoundResult result;
+	for (std::size_t thread_index = 0; thread_index < args.thread_count; ++thread_index) {
+		threads[thread_index].join();
+		result += thread_results[thread_index];
+	}
+	return result;
+}
+
+// 95% Wilson score interval of the win rate.
+static std::pair<double, double> get_confidence_interval(uint64_t win_count, uint64_t game_count) {
+	constexpr double z = 1.96;
+	const double n = static_cast<double>(game_count);
+	const double p = win_count / n;
+	const double denominator = 1.0 + z * z / n;
+	const double center = (p + z * z / (2.0 * n)) / denominator;
+	const double half_width =
+	    z * std::sqrt(p * (1.0 - p) / n + z * z / (4.0 * n * n)) / denominator;
+	return {std::max(0.0, center - half_width), std::min(1.0, center + half_width)};
+}
+
+int main(int argc, char **argv) {
+	Args args = parse_cmd_args(argc, argv);
+
+	if (args.should_output_help) {
+		print_help();
+		return 0;
+	}
+	if (args.round < 0 || args.round > static_cast<int>(ROUND_CONFIGS.size())) {
+		std::cerr << "[ERROR] Round out of range, see --help.\n";
+		return 1;
+	}
+
+	// Games run in parallel, every search runs on the thread of its game. They share the default
+	// context and with it the transposition table.
+	get_default_search_context().resize_caches(args.hash_size_mb);
+
+	RoundResult total;
+	double total_seconds = 0.0;
+	for (int round_index = 0; round_index < static_cast<int>(ROUND_CONFIGS.size()); ++round_index) {
+		if (args.round != 0 && args.round != round_index + 1) {
+			continue;
+		}
+		RoundConfig config = ROUND_CONFIGS[round_index];
+		if (args.is_double_or_nothing) {
+			config.items_per_load = DOUBLE_OR_NOTHING_MAX_ITEMS_PER_LOAD;
+			config.is_double_or_nothing = true;
+		}
+
+		const auto start_time = std::chrono::steady_clock::now();
+		const RoundResult result = play_round(config, round_index, args);
+		const double seconds =
+		    std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+		const auto [low, high] = get_confidence_interval(result.win_count, result.game_count);
+		total += result;
+		total_seconds += seconds;
+
+		std::cout << "{\"round\": " << round_index + 1 << ", \"max_lives\": " << config.max_lives
+		          << ", \"double_or_nothing\": " << (config.is_double_or_nothing ? "true" : "false")
+		          << ", \"items_per_load\": " << config.items_per_load
+		          << ", \"games\": " << result.game_count << ", \"wins\": " << result.win_count
+		          << ", \"win_rate\": " << static_cast<double>(result.win_count) / result.game_count
+		          << ", \"ci95_low\": " << low << ", \"ci95_high\": " << high
+		          << ", \"loads_per_game\": "
+		          << static_cast<double>(result.load_count) / result.game_count
+		          << ", \"actions_per_game\": "
+		          << static_cast<double>(result.player_action_count) / result.game_count
+		          << ", \"wall_ms\": " << seconds * 1000.0
+		          << ", \"games_per_sec\": " << (seconds > 0.0 ? result.game_count / seconds : 0.0)
+		          << "}\n";
+	}
+
+	std::cout << "{\"summary\": true, \"games\": " << total.game_count
+	          << ", \"threads\": " << args.thread_count
+	          << ", \"wall_ms\": " << total_seconds * 1000.0
+	          << ", \"games_per_sec\": "
+	          << (total_seconds > 0.0 ? total.game_count / total_seconds : 0.0) << "}\n";
+	return 0;
+}
@@ -0,0 +1,203 @@
+#include "state_index.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+// The six valid combinations of handsaw_applied, handcuffs_applied and handcuffs_available.
+constexpr int FLAG_COMBINATION_COUNT = 6;
+
+// Number of ways to hold the later kinds, 0 to MAX_LATER_ITEM_KIND_COUNT of each.
+constexpr int LATER_INVENTORY_COUNT = 256;
+static_assert(LATER_INVENTORY_COUNT == (MAX_LATER_ITEM_KIND_COUNT + 1) *
+                                           (MAX_LATER_ITEM_KIND_COUNT + 1) *
+                                           (MAX_LATER_ITEM_KIND_COUNT + 1) *
+                                           (MAX_LATER_ITEM_KIND_COUNT + 1));
+
+// Dense key of items a side can hold: the classic rank, then the later kinds as base 4 digits.
+static int get_inventory_key(uint64_t items) {
+	int later_digits = 0;
+	for (int kind = ITEM_KIND_COUNT - 1; kind >= CLASSIC_ITEM_KIND_COUNT; --kind) {
+		later_digits = later_digits * (MAX_LATER_ITEM_KIND_COUNT + 1) +
+		               (items >> (kind * ITEM_KIND_BITS) & 0xF);
+	}
+	return CLASSIC_INVENTORY_TABLE.get_rank(items) * LATER_INVENTORY_COUNT + later_digits;
+}
+
+StateIndexer::InventoryIndex::InventoryIndex(ItemManager item_caps, int max_items) {
+	for (int classic_rank = 0; classic_rank < ClassicInventoryTable::SIZE; ++classic_rank) {
+		for (int later_digits = 0; later_digits < LATER_INVENTORY_COUNT; ++later_digits) {
+			uint64_t items = CLASSIC_INVENTORY_TABLE.items[classic_rank];
+			for (int kind = CLASSIC_ITEM_KIND_COUNT, rest = later_digits; kind < ITEM_KIND_COUNT;
+			     ++kind, rest /= MAX_LATER_ITEM_KIND_COUNT + 1) {
+				items |= static_cast<uint64_t>(rest % (MAX_LATER_ITEM_KIND_COUNT + 1))
+				         << (kind * ITEM_KIND_BITS);
+			}
+			ItemManager inventory;
+			inventory.items = items;
+			bool within_caps = inventory.get_item_count() <= max_items;
+			for (int kind = 0; kind < ITEM_KIND_COUNT; ++kind) {
+				within_caps &= (items >> (kind * ITEM_KIND_BITS) & 0xF) <=
+				               (item_caps.items >> (kind * ITEM_KIND_BITS) & 0xF);
+			}
+			if (within_caps) {
+				this->inventories.push_back(inventory);
+			}
+		}
+	}
+
+	// Ordered by the packed counts, the last kind being the most significant.
+	std::sort(this->inventories.begin(), this->inventories.end(),
+	          [](ItemManager a, ItemManager b) { return a.items < b.items; });
+	this->ranks.assign(ClassicInventoryTable::SIZE * LATER_INVENTORY_COUNT, -1);
+	for (std::size_t i = 0; i < this->inventories.size(); ++i) {
+		this->ranks[get_inventory_key(this->inventories[i].items)] = static_cast<int32_t>(i);
+	}
+}
+
+uint32_t StateIndexer::InventoryIndex::size(void) const { return this->inventories.size(); }
+
+int32_t StateIndexer::InventoryIndex::rank(ItemManager items) const {
+	if (!items.can_be_held()) {
+		return -1;
+	}
+	return this->ranks[get_inventory_key(items.items)];
+}
+
+ItemManager StateIndexer::InventoryIndex::unrank(uint32_t index) const {
+	return this->inventories[index];
+}
+
+int StateIndexer::get_shell_key(int live_round_count, int blank_round_count, bool curr_is_live,
+                                bool curr_is_blank) {
+	const int knowledge = curr_is_live ? 1 : curr_is_blank ? 2 : 0;
+	return (live_round_count * (MAX_SHELL_COUNT + 1) + blank_round_count) * 3 + knowledge;
+}
+
+StateIndexer::StateIndexer(const StateBounds &bounds)
+    : bounds(bounds),
+      dealer_inventories(bounds.dealer_item_caps, bounds.max_dealer_items),
+      player_inventories(bounds.player_item_caps, bounds.max_player_items) {
+	assert(bounds.max_shells <= MAX_SHELL_COUNT);
+	this->shell_ranks.fill(-1);
+
+	for (int shell_count = 1; shell_count <= bounds.max_shells; ++shell_count) {
+		for (int live_round_count = 0; live_round_count <= shell_count; ++live_round_count) {
+			const int blank_round_count = shell_count - live_round_count;
+			if (live_round_count > bounds.max_live_rounds ||
+			    blank_round_count > bounds.max_blank_rounds) {
+				continue;
+			}
+			for (int knowledge = 0; knowledge < 3; ++knowledge) {
+				const bool curr_is_live = knowledge == 1;
+				const bool curr_is_blank = knowledge == 2;
+				if ((curr_is_live && live_round_count == 0) ||
+				    (curr_is_blank && blank_round_count == 0)) {
+					continue;
+				}
+				this->shell_ranks[get_shell_key(live_round_count, blank_round_count, curr_is_live,
+				                                curr_is_blank)] = this->shell_states.size();
+				this->shell_states.push_back(ShellState{static_cast<uint8_t>(live_round_count),
+				                                        static_cast<uint8_t>(blank_round_count),
+				                                        curr_is_live, curr_is_blank});
+			}
+		}
+	}
+
+	this->lives_count = static_cast<uint64_t>(bounds.max_lives) * bounds.max_lives;
+	this->inventory_count =
+	    static_cast<uint64_t>(this->player_inventories.size()) * this->dealer_inventories.size();
+	this->turn_size = this->shell_states.size() * this->lives_count * FLAG_COMBINATION_COUNT *
+	                  this->inventory_count;
+}
+
+StateIndexer StateIndexer::for_root(const Node &root) {
+	// Within a load shells and items only ever get used up, so the root bounds every descendant.
+	// Cigarettes can heal, so lives are bounded by max_lives instead, and an inverter can turn any
+	// shell into the other type.
+	const int shell_count = root.get_live_round_count() + root.get_blank_round_count();
+	const bool has_inverter = root.get_dealer_items().has<ItemKind::INVERTER>() ||
+	                          root.get_player_items().has<ItemKind::INVERTER>();
+	return StateIndexer(StateBounds{
+	    static_cast<uint8_t>(root.get_max_lives()),
+	    static_cast<uint8_t>(has_inverter ? shell_count : root.get_live_round_count()),
+	    static_cast<uint8_t>(has_inverter ? shell_count : root.get_blank_round_count()),
+	    static_cast<uint8_t>(shell_count),
+	    root.get_dealer_items(), root.get_player_items(),
+	    static_cast<uint8_t>(root.get_dealer_items().get_item_count()),
+	    static_cast<uint8_t>(root.get_player_items().get_item_count())});
+}
+
+uint64_t StateIndexer::size(void) const { return this->turn_size * 2; }
+
+uint64_t StateIndexer::size_per_turn(void) const { return this->turn_size; }
+
+const StateBounds &StateIndexer::get_bounds(void) const { return this->bounds; }
+
+bool StateIndexer::contains(const Node &node) const {
+	if (node.get_max_lives() != this->bounds.max_lives || node.get_dealer_lives() == 0 ||
+	    node.get_player_lives() == 0 || node.get_dealer_lives() > this->bounds.max_lives ||
+	    node.get_player_lives() > this->bounds.max_lives ||
+	    (node.is_handcuffs_applied() && !node.is_handcuffs_available()) ||
+	    node.is_round_inverted() || node.is_adrenaline_applied() || node.is_reload_pending() ||
+	    node.is_double_or_nothing()) {
+		return false;
+	}
+	if (node.get_live_round_count() > MAX_SHELL_COUNT ||
+	    node.get_blank_round_count() > MAX_SHELL_COUNT ||
+	    (node.round_known_live() && node.round_known_blank()) ||
+	    this->shell_ranks[get_shell_key(node.get_live_round_count(), node.get_blank_round_count(),
+	                                    node.round_known_live(), node.round_known_blank())] < 0) {
+		return false;
+	}
+	return this->dealer_inventories.rank(node.get_dealer_items()) >= 0 &&
+	       this->player_inventories.rank(node.get_player_items()) >= 0;
+}
+
+uint64_t StateIndexer::rank(const Node &node) const {
+	assert(this->contains(node));
+
+	const uint64_t shell_rank =
+	    this->shell_ranks[get_shell_key(node.get_live_round_count(), node.get_blank_round_count(),
+	                                    node.round_known_live(), node.round_known_blank())];
+	const uint64_t lives_rank =
+	    static_cast<uint64_t>(node.get_dealer_lives() - 1) * this->bounds.max_lives +
+	    node.get_player_lives() - 1;
+	const uint64_t handcuffs_rank =
+	    node.is_handcuffs_applied() ? 1 : node.is_handcuffs_available() ? 0 : 2;
+	const uint64_t flags_rank = handcuffs_rank * 2 + node.is_handsaw_applied();
+
+	uint64_t index = node.is_dealer_turn();
+	index = index * this->shell_states.size() + shell_rank;
+	index = index * this->lives_count + lives_rank;
+	index = index * FLAG_COMBINATION_COUNT + flags_rank;
+	index = index * this->player_inventories.size() +
+	        this->player_inventories.rank(node.get_player_items());
+	index = index * this->dealer_inventories.size() +
+	        this->dealer_inventories.rank(node.get_dealer_items());
+	return index;
+}
+
+Node StateIndexer::unrank(uint64_t index) const {
+	assert(index < this->size());
+
+	const ItemManager dealer_items =
+	    this->dealer_inventories.unrank(index % this->dealer_inventories.size());
+	index /= this->dealer_inventories.size();
+	const ItemManager player_items =
+	    this->player_inventories.unrank(index % this->player_inventories.size());
+	index /= this->player_inventories.size();
+	const uint64_t flags_rank = index % FLAG_COMBINATION_COUNT;
+	index /= FLAG_COMBINATION_COUNT;
+	const uint64_t lives_rank = index % this->lives_count;
+	index /= this->lives_count;
+	const ShellState &shells = this->shell_states[index % this->shell_states.size()];
+	index /= this->shell_states.size();
+	const bool is_dealer_turn = index;
+
+	const uint64_t handcuffs_rank = flags_rank / 2;
+	return Node(is_dealer_turn, shells.curr_is_live, shells.curr_is_blank, shells.live_round_count,
+	            shells.blank_round_count, this->bounds.max_lives,
+	            lives_rank / this->bounds.max_lives + 1, lives_rank % this->bounds.max_lives + 1,
+	            dealer_items, player_items, flags_rank & 0b1, handcuffs_rank == 1,
+	            handcuffs_rank != 2);
+}
@@ -0,0 +1,84 @@
+#ifndef STATE_INDEX_HPP
+#define STATE_INDEX_HPP
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "expectimax.hpp"
+#include "item_manager.hpp"
+
+constexpr int MAX_SHELL_COUNT = 8;
+
+// The space of non-terminal states an indexer ranks. Item caps bound every item kind separately,
+// the totals bound the number of items a side holds.
+struct StateBounds {
+	uint8_t max_lives;
+	uint8_t max_live_rounds;
+	uint8_t max_blank_rounds;
+	uint8_t max_shells;
+	ItemManager dealer_item_caps;
+	ItemManager player_item_caps;
+	uint8_t max_dealer_items;
+	uint8_t max_player_items;
+};
+
+// Dense bijection between the valid states within a StateBounds and [0, size()). Invalid field
+// combinations (no shells, zero lives, a known round of a type that is not loaded, handcuffs
+// applied after they were used up) get no index, so memo tables and tablebases can be flat arrays
+// without stored keys. Neither do states with an inverted round or adrenaline in effect, nor those
+// waiting on a reload or playing double or nothing, which the layout has no digit for.
+//
+// Mixed radix layout, outermost first:
+// - turn (all player turn states come first)
+// - shells: (live, blank, knowledge) ordered by total shell count
+// - dealer lives, player lives (1 to max_lives each)
+// - per-turn flags: handsaw applied x handcuffs {available, applied, used up}
+// - player inventory, dealer inventory
+class StateIndexer final {
+   public:
+	explicit StateIndexer(const StateBounds &bounds);
+	static StateIndexer for_root(const Node &root);
+
+	uint64_t size(void) const;
+	uint64_t size_per_turn(void) const;
+	bool contains(const Node &node) const;
+	uint64_t rank(const Node &node) const;
+	Node unrank(uint64_t index) const;
+	const StateBounds &get_bounds(void) const;
+
+   private:
+	// Ranks the inventories allowed by a cap per item kind and a cap on the total.
+	class InventoryIndex final {
+	   public:
+		InventoryIndex(ItemManager item_caps, int max_items);
+
+		uint32_t size(void) const;
+		int32_t rank(ItemManager items) const;
+		ItemManager unrank(uint32_t index) const;
+
+	   private:
+		std::vector<int32_t> ranks;  // indexed by get_inventory_key(), -1 if out of bounds
+		std::vector<ItemManager> inventories;
+	};
+
+	struct ShellState {
+		uint8_t live_round_count;
+		uint8_t blank_round_count;
+		bool curr_is_live;
+		bool curr_is_blank;
+	};
+
+	static int get_shell_key(int live_round_count, int blank_round_count, bool curr_is_live,
+	                         bool curr_is_blank);
+
+	StateBounds bounds;
+	InventoryIndex dealer_inventories;
+	InventoryIndex player_inventories;
+	std::vector<ShellState> shell_states;
+	std::array<int16_t, (MAX_SHELL_COUNT + 1) * (MAX_SHELL_COUNT + 1) * 3> shell_ranks;
+	uint64_t lives_count;
+	uint64_t inventory_count;
+	uint64_t turn_size;
+};
+
+#endif  // STATE_INDEX_HPP
@@ -0,0 +1,111 @@
+#include "tablebase.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+Tablebase tablebase;
+
+Tablebase::~Tablebase() { this->close(); }
+
+StateIndexer Tablebase::get_indexer(uint8_t max_lives, uint8_t max_shells, uint8_t max_items) {
+	const ItemManager item_caps(max_items, max_items, max_items, max_items, max_items, 0, 0, 0, 0);
+	return StateIndexer(StateBounds{max_lives, max_shells, max_shells, max_shells, item_caps,
+	                                item_caps, max_items, max_items});
+}
+
+bool Tablebase::open(const std::string &path) {
+	this->close();
+
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 ||
+	    static_cast<std::size_t>(file_stat.st_size) < sizeof(TablebaseHeader)) {
+		::close(fd);
+		return false;
+	}
+
+	void *mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (mapping == MAP_FAILED) {
+		return false;
+	}
+
+	const TablebaseHeader *header = static_cast<const TablebaseHeader *>(mapping);
+	if (std::memcmp(header->magic, TABLEBASE_MAGIC, sizeof(TABLEBASE_MAGIC)) != 0 ||
+	    header->version != TABLEBASE_VERSION ||
+	    (header->max_lives != 2 && header->max_lives != 4 && header->max_lives != 6) ||
+	    header->max_shells < 1 || header->max_shells > MAX_SHELL_COUNT ||
+	    header->max_items > MAX_HELD_ITEM_COUNT) {
+		munmap(mapping, file_stat.st_size);
+		return false;
+	}
+
+	StateIndexer indexer = get_indexer(header->max_lives, header->max_shells, header->max_items);
+	if (header->entry_count != indexer.size_per_turn() ||
+	    static_cast<std::size_t>(file_stat.st_size) !=
+	        sizeof(TablebaseHeader) + header->entry_count * sizeof(TablebaseEntry)) {
+		munmap(mapping, file_stat.st_size);
+		return false;
+	}
+
+	this->mapping = mapping;
+	this->mapping_size = file_stat.st_size;
+	this->entries = reinterpret_cast<const TablebaseEntry *>(static_cast<const char *>(mapping) +
+	                                                         sizeof(TablebaseHeader));
+	this->entry_count = header->entry_count;
+	this->indexer.emplace(std::move(indexer));
+	return true;
+}
+
+void Tablebase::close(void) {
+	if (this->mapping != nullptr) {
+		munmap(this->mapping, this->mapping_size);
+	}
+	this->mapping = nullptr;
+	this->mapping_size = 0;
+	this->entries = nullptr;
+	this->entry_count = 0;
+	this->indexer.reset();
+}
+
+bool Tablebase::is_open(void) const { return this->mapping != nullptr; }
+
+std::size_t Tablebase::get_entry_count(void) const { return this->entry_count; }
+
+std::optional<std::pair<Action, float>> Tablebase::probe(const Node &node) const {
+	// Entries are scored at the end of the load, campaign positions look further.
+	if (this->entries == nullptr || !node.is_player_turn() || node.is_reload_pending() ||
+	    !this->indexer->contains(node)) {
+		return std::nullopt;
+	}
+
+	const TablebaseEntry &entry = this->entries[this->indexer->rank(node)];
+	return std::pair<Action, float>(static_cast<Action>(entry.action), entry.ev);
+}
+
+bool Tablebase::write(const std::string &path, uint8_t max_lives, uint8_t max_shells,
+                      uint8_t max_items, const std::vector<TablebaseEntry> &entries) {
+	TablebaseHeader header{};
+	std::memcpy(header.magic, TABLEBASE_MAGIC, sizeof(TABLEBASE_MAGIC));
+	header.version = TABLEBASE_VERSION;
+	header.max_lives = max_lives;
+	header.max_shells = max_shells;
+	header.max_items = max_items;
+	header.entry_count = entries.size();
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(entries.data()),
+	           static_cast<std::streamsize>(entries.size() * sizeof(TablebaseEntry)));
+	return static_cast<bool>(file);
+}
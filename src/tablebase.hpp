@@ -0,0 +1,68 @@
+#ifndef TABLEBASE_HPP
+#define TABLEBASE_HPP
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "expectimax.hpp"
+#include "state_index.hpp"
+
+constexpr char TABLEBASE_MAGIC[8] = {'B', 'R', 'T', 'B', 'A', 'S', 'E', '\0'};
+constexpr uint32_t TABLEBASE_VERSION = 4;
+
+// On disk the tablebase is a header followed by one entry per player-to-move state of its bounds,
+// in StateIndexer order. No keys are stored; a state's entry is found by ranking it. All fields
+// are in host byte order.
+struct TablebaseHeader {
+	char magic[8];
+	uint32_t version;
+	uint8_t max_lives;
+	uint8_t max_shells;
+	uint8_t max_items;
+	uint8_t reserved;
+	uint64_t entry_count;
+};
+
+struct TablebaseEntry {
+	float ev;
+	uint8_t action;
+	uint8_t padding[3];
+};
+
+static_assert(sizeof(TablebaseHeader) == 24);
+static_assert(sizeof(TablebaseEntry) == 8);
+
+class Tablebase final {
+   public:
+	Tablebase() = default;
+	~Tablebase();
+
+	Tablebase(const Tablebase &) = delete;
+	Tablebase &operator=(const Tablebase &) = delete;
+
+	bool open(const std::string &path);
+	void close(void);
+	bool is_open(void) const;
+	std::size_t get_entry_count(void) const;
+	std::optional<std::pair<Action, float>> probe(const Node &node) const;
+
+	// Only the classic item kinds are indexed, so the bounds describe all classic positions with up
+	// to max_items items per side.
+	static StateIndexer get_indexer(uint8_t max_lives, uint8_t max_shells, uint8_t max_items);
+	static bool write(const std::string &path, uint8_t max_lives, uint8_t max_shells,
+	                  uint8_t max_items, const std::vector<TablebaseEntry> &entries);
+
+   private:
+	void *mapping = nullptr;
+	std::size_t mapping_size = 0;
+	const TablebaseEntry *entries = nullptr;
+	uint64_t entry_count = 0;
+	std::optional<StateIndexer> indexer;
+};
+
+extern Tablebase tablebase;
+
+#endif  // TABLEBASE_HPP
@@ -0,0 +1,129 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "expectimax.hpp"
+#include "search_context.hpp"
+#include "state_index.hpp"
+#include "tablebase.hpp"
+#include "transposition_table.hpp"
+
+struct Args {
+	bool should_output_help = false;
+	int max_lives = 2;
+	int max_shells = 8;
+	int max_items = 2;
+	std::size_t hash_size_mb = TRANSPOSITION_TABLE_DEFAULT_SIZE_MB;
+	std::size_t thread_count = 1;
+	std::string output_path = "buckshot-roulette.tb";
+};
+
+void print_help(void) {
+	std::cout << "Usage: buckshot-roulette-tablebase [FLAGS]\n"
+	          << "Solves every player-to-move position within the given bounds and writes the\n"
+	          << "best actions to a tablebase file that buckshot-roulette loads with --tablebase.\n"
+	          << "  --help, --h        : Print this help message.\n"
+	          << "  --max-lives <N>    : Life tier to solve, 2, 4 or 6 (default 2).\n"
+	          << "  --max-shells <N>   : Maximum number of shells in the shotgun, 1-8\n"
+	          << "                       (default 8).\n"
+	          << "  --max-items <N>    : Maximum number of items per side, 0-8 (default 2).\n"
+	          << "  --hash <MB>        : Size of the transposition table in megabytes (default "
+	          << TRANSPOSITION_TABLE_DEFAULT_SIZE_MB << ").\n"
+	          << "  --threads <N>      : Search on N threads (default 1).\n"
+	          << "  --output <PATH>    : Output file (default buckshot-roulette.tb).\n";
+}
+
+Args parse_cmd_args(int argc, char **argv) {
+	Args args;
+	for (int i = 1; i < argc; ++i) {
+		std::string curr = argv[i];
+		if (curr == "--h" || curr == "--help") {
+			args.should_output_help = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			std::cerr << "[WARNING] Ignoring command line argument '" << curr << "'.\n";
+			continue;
+		}
+
+		try {
+			if (curr == "--max-lives") {
+				args.max_lives = std::stoi(argv[++i]);
+			}
+			else if (curr == "--max-shells") {
+				args.max_shells = std::stoi(argv[++i]);
+			}
+			else if (curr == "--max-items") {
+				args.max_items = std::stoi(argv[++i]);
+			}
+			else if (curr == "--hash") {
+				args.hash_size_mb = std::stoul(argv[++i]);
+			}
+			else if (curr == "--threads") {
+				args.thread_count = std::stoul(argv[++i]);
+			}
+			else if (curr == "--output") {
+				args.output_path = argv[++i];
+			}
+			else {
+				std::cerr << "[WARNING] Ignoring command line argument '" << curr << "'.\n";
+			}
+		}
+		catch (const std::exception &) {
+			std::cerr << "[WARNING] Invalid value '" << argv[i] << "' for " << curr
+			          << ", using default.\n";
+		}
+	}
+	return args;
+}
+
+int main(int argc, char **argv) {
+	Args args = parse_cmd_args(argc, argv);
+
+	if (args.should_output_help) {
+		print_help();
+		return 0;
+	}
+	if ((args.max_lives != 2 && args.max_lives != 4 && args.max_lives != 6) ||
+	    args.max_shells < 1 || args.max_shells > 8 || args.max_items < 0 || args.max_items > 8) {
+		std::cerr << "[ERROR] Bounds out of range, see --help.\n";
+		return 1;
+	}
+
+	SearchContext context(args.hash_size_mb, args.thread_count);
+
+	const StateIndexer indexer =
+	    Tablebase::get_indexer(args.max_lives, args.max_shells, args.max_items);
+	std::vector<TablebaseEntry> entries(indexer.size_per_turn(), TablebaseEntry{});
+	const auto start_time = std::chrono::steady_clock::now();
+
+	// Player-to-move states come first in index order and are ordered by shell count, so small
+	// loads are solved first and every larger load finds its subtrees in the warm table.
+	int solved_shell_count = 0;
+	for (uint64_t index = 0; index < entries.size(); ++index) {
+		Node node = indexer.unrank(index);
+		const int shell_count = node.get_live_round_count() + node.get_blank_round_count();
+		if (shell_count != solved_shell_count) {
+			solved_shell_count = shell_count;
+			const double elapsed = std::chrono::duration<double>(
+			                           std::chrono::steady_clock::now() - start_time)
+			                           .count();
+			std::cerr << "[INFO] Solving loads of " << shell_count << " shells (" << index
+			          << " positions done in " << elapsed << "s).\n";
+		}
+
+		auto [action, ev] = node.get_best_action(context);
+		entries[index].ev = ev;
+		entries[index].action = static_cast<uint8_t>(action);
+	}
+
+	if (!Tablebase::write(args.output_path, args.max_lives, args.max_shells, args.max_items,
+	                      entries)) {
+		std::cerr << "[ERROR] Failed to write '" << args.output_path << "'.\n";
+		return 1;
+	}
+	std::cout << "[INFO] Wrote " << entries.size() << " positions to '" << args.output_path
+	          << "'.\n";
+	return 0;
+}
@@ -0,0 +1,135 @@
+#include "task_scheduler.hpp"
+
+#include <chrono>
+
+namespace {
+// The scheduler whose worker runs on this thread (nullptr outside of any worker) and its index.
+thread_local const TaskScheduler *current_scheduler = nullptr;
+thread_local std::size_t current_worker_index = 0;
+}  // namespace
+
+TaskScheduler::TaskScheduler(std::size_t thread_count) {
+	const std::size_t worker_count = thread_count > 1 ? thread_count - 1 : 0;
+	for (std::size_t i = 0; i < worker_count; ++i) {
+		this->worker_queues.emplace_back(std::make_unique<TaskQueue>());
+	}
+	for (std::size_t i = 0; i < worker_count; ++i) {
+		this->workers.emplace_back(&TaskScheduler::worker_loop, this, i);
+	}
+}
+
+TaskScheduler::~TaskScheduler() {
+	{
+		std::lock_guard<std::mutex> lock(this->sleep_mutex);
+		this->is_stopping.store(true);
+	}
+	this->sleep_cv.notify_all();
+	for (std::thread &worker : this->workers) {
+		worker.join();
+	}
+}
+
+std::size_t TaskScheduler::get_thread_count(void) const { return this->workers.size() + 1; }
+
+void TaskScheduler::push(Task task) {
+	TaskQueue &queue = current_scheduler == this ? *this->worker_queues[current_worker_index]
+	                                             : this->injection_queue;
+	this->queued_task_count.fetch_add(1);
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.emplace_back(std::move(task));
+	}
+	this->sleep_cv.notify_one();
+}
+
+bool TaskScheduler::pop_back(TaskQueue &queue, Task &task) {
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tasks.empty()) {
+		return false;
+	}
+	task = std::move(queue.tasks.back());
+	queue.tasks.pop_back();
+	return true;
+}
+
+bool TaskScheduler::pop_front(TaskQueue &queue, Task &task) {
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tasks.empty()) {
+		return false;
+	}
+	task = std::move(queue.tasks.front());
+	queue.tasks.pop_front();
+	return true;
+}
+
+bool TaskScheduler::find_task(Task &task) {
+	if (this->queued_task_count.load() == 0) {
+		return false;
+	}
+
+	// Own work is taken newest first so a waiting thread finishes its subtree depth first instead
+	// of nesting ever larger tasks on its stack. Workers take injected tasks oldest first.
+	const bool is_worker = current_scheduler == this;
+	if (is_worker && this->pop_back(*this->worker_queues[current_worker_index], task)) {
+		return true;
+	}
+	if (is_worker ? this->pop_front(this->injection_queue, task)
+	              : this->pop_back(this->injection_queue, task)) {
+		return true;
+	}
+
+	const std::size_t first_victim = is_worker ? current_worker_index + 1 : 0;
+	for (std::size_t i = 0; i < this->worker_queues.size(); ++i) {
+		const std::size_t victim = (first_victim + i) % this->worker_queues.size();
+		if (this->pop_front(*this->worker_queues[victim], task)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool TaskScheduler::run_one(void) {
+	Task task;
+	if (!this->find_task(task)) {
+		return false;
+	}
+	this->queued_task_count.fetch_sub(1);
+	task();
+	return true;
+}
+
+void TaskScheduler::worker_loop(std::size_t worker_index) {
+	current_scheduler = this;
+	current_worker_index = worker_index;
+
+	while (!this->is_stopping.load()) {
+		if (this->run_one()) {
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(this->sleep_mutex);
+		// The timeout covers a push racing with the check above.
+		this->sleep_cv.wait_for(lock, std::chrono::milliseconds(1), [this] {
+			return this->is_stopping.load() || this->queued_task_count.load() > 0;
+		});
+	}
+}
+
+TaskGroup::TaskGroup(TaskScheduler &scheduler) : scheduler(scheduler) {}
+
+TaskGroup::~TaskGroup() { this->wait(); }
+
+void TaskGroup::spawn(Task task) {
+	this->pending_task_count.fetch_add(1);
+	this->scheduler.push([this, task = std::move(task)] {
+		task();
+		this->pending_task_count.fetch_sub(1, std::memory_order_release);
+	});
+}
+
+void TaskGroup::wait(void) {
+	while (this->pending_task_count.load(std::memory_order_acquire) > 0) {
+		if (!this->scheduler.run_one()) {
+			std::this_thread::yield();
+		}
+	}
+}
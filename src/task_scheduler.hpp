@@ -0,0 +1,70 @@
+#ifndef TASK_SCHEDULER_HPP
+#define TASK_SCHEDULER_HPP
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using Task = std::function<void(void)>;
+
+// Work-stealing scheduler for fork/join style tasks. Every worker owns a deque: it pushes and pops
+// its own tasks at the back (newest, smallest subtree first) and idle workers steal from the front
+// of other deques (oldest, largest subtree first). Threads outside the scheduler submit through a
+// shared injection queue and help executing tasks while they wait on a TaskGroup, so a scheduler of
+// N threads starts N - 1 workers.
+class TaskScheduler final {
+   public:
+	explicit TaskScheduler(std::size_t thread_count);
+	~TaskScheduler();
+
+	TaskScheduler(const TaskScheduler &) = delete;
+	TaskScheduler &operator=(const TaskScheduler &) = delete;
+
+	std::size_t get_thread_count(void) const;
+	void push(Task task);
+	bool run_one(void);
+
+   private:
+	struct TaskQueue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void worker_loop(std::size_t worker_index);
+	bool pop_back(TaskQueue &queue, Task &task);
+	bool pop_front(TaskQueue &queue, Task &task);
+	bool find_task(Task &task);
+
+	std::vector<std::unique_ptr<TaskQueue>> worker_queues;
+	TaskQueue injection_queue;
+	std::vector<std::thread> workers;
+	std::atomic<std::size_t> queued_task_count{0};
+	std::mutex sleep_mutex;
+	std::condition_variable sleep_cv;
+	std::atomic<bool> is_stopping{false};
+};
+
+// A set of tasks spawned from one fork point. wait() returns once all of them have finished and
+// runs queued tasks on the calling thread in the meantime.
+class TaskGroup final {
+   public:
+	explicit TaskGroup(TaskScheduler &scheduler);
+	~TaskGroup();
+
+	TaskGroup(const TaskGroup &) = delete;
+	TaskGroup &operator=(const TaskGroup &) = delete;
+
+	void spawn(Task task);
+	void wait(void);
+
+   private:
+	TaskScheduler &scheduler;
+	std::atomic<std::size_t> pending_task_count{0};
+};
+
+#endif  // TASK_SCHEDULER_HPP
@@ -1,38 +1,158 @@
 #include "transposition_table.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <optional>
 
+#include "search_stats.hpp"
+
 std::size_t std::hash<Node>::operator()(const Node &node) const {
-	return static_cast<std::size_t>(node.dealer_items.items & 0xFFFFF) |
-	       (static_cast<std::size_t>(node.player_items.items & 0xFFFFF) << 20) |
-	       (static_cast<std::size_t>(node.live_round_count & 0xF) << 40) |
-	       (static_cast<std::size_t>(node.blank_round_count & 0b111) << 44) |
-	       (static_cast<std::size_t>(node.max_lives & 0b111) << 47) |
-	       (static_cast<std::size_t>(node.dealer_lives & 0b111) << 50) |
-	       (static_cast<std::size_t>(node.player_lives & 0b111) << 53) |
-	       (static_cast<std::size_t>(node.is_dealer_turn & 0b1) << 56) |
-	       (static_cast<std::size_t>(node.curr_is_live & 0b1) << 57) |
-	       (static_cast<std::size_t>(node.curr_is_blank & 0b1) << 58) |
-	       (static_cast<std::size_t>(node.handsaw_applied & 0b1) << 59) |
-	       (static_cast<std::size_t>(node.handcuffs_applied & 0b1) << 60) |
-	       (static_cast<std::size_t>(node.handcuffs_available & 0b1) << 61);
-}
-
-void TranspositionTableManager::add_node(const Node &node, float ev) {
-	if (this->transposition_table.size() == TRANSPOSITION_TABLE_MAX_SIZE) {
-		auto it = this->transposition_table.begin();
-		this->transposition_table.erase(it);
+	return node.get_canonical_key();
+}
+
+static uint64_t pack_entry_data(float ev, uint8_t depth, uint8_t generation,
+                                uint8_t cutoff_shell_count) {
+	uint32_t ev_bits;
+	std::memcpy(&ev_bits, &ev, sizeof(ev_bits));
+	return static_cast<uint64_t>(ev_bits) | static_cast<uint64_t>(depth) << 32 |
+	       static_cast<uint64_t>(generation) << 40 |
+	       static_cast<uint64_t>(cutoff_shell_count) << 48;
+}
+
+static float get_entry_ev(uint64_t data) {
+	const uint32_t ev_bits = static_cast<uint32_t>(data);
+	float ev;
+	std::memcpy(&ev, &ev_bits, sizeof(ev));
+	return ev;
+}
+
+static uint8_t get_entry_depth(uint64_t data) { return data >> 32 & 0xFF; }
+
+static uint8_t get_entry_generation(uint64_t data) { return data >> 40 & 0xFF; }
+
+static uint8_t get_entry_cutoff_shell_count(uint64_t data) { return data >> 48 & 0xFF; }
+
+static void store_entry(TranspositionEntry &entry, uint64_t key, uint64_t data) {
+	entry.key_xor_data.store(key ^ data, std::memory_order_relaxed);
+	entry.data.store(data, std::memory_order_relaxed);
+}
+
+TranspositionTableManager::TranspositionTableManager(std::size_t size_mb) { this->resize(size_mb); }
+
+void TranspositionTableManager::resize(std::size_t size_mb) {
+	// Round down to a power of two so that the bucket index is the top bits of the mixed key.
+	std::size_t bucket_count = 1;
+	uint64_t index_bits = 0;
+	const std::size_t size_bytes = std::max<std::size_t>(size_mb, 1) << 20;
+	while (bucket_count * 2 * sizeof(TranspositionBucket) <= size_bytes) {
+		bucket_count *= 2;
+		index_bits++;
+	}
+
+	this->buckets = std::make_unique<TranspositionBucket[]>(bucket_count);
+	this->bucket_count = bucket_count;
+	this->index_shift = 64 - index_bits;
+}
+
+std::size_t TranspositionTableManager::get_size_mb(void) const {
+	return this->bucket_count * sizeof(TranspositionBucket) >> 20;
+}
+
+TranspositionBucket &TranspositionTableManager::get_bucket(uint64_t key) {
+	// The key is a packed bit field, so spread it with a Fibonacci multiply before indexing.
+	return this->buckets[(key * 0x9E3779B97F4A7C15ULL) >> this->index_shift];
+}
+
+void TranspositionTableManager::add_node(const Node &node, float ev, uint8_t cutoff_shell_count) {
+	const uint64_t key = std::hash<Node>{}(node);
+	const uint8_t depth = node.get_subtree_depth();
+	const uint8_t generation = this->generation.load(std::memory_order_relaxed);
+	TranspositionBucket &bucket = this->get_bucket(key);
+	count_search_stat(&SearchCounters::tt_stores);
+
+	for (TranspositionEntry &entry : bucket.entries) {
+		const uint64_t data = entry.data.load(std::memory_order_relaxed);
+		if ((entry.key_xor_data.load(std::memory_order_relaxed) ^ data) == key) {
+			if (cutoff_shell_count <= get_entry_cutoff_shell_count(data)) {
+				store_entry(entry, key,
+				            pack_entry_data(ev, std::max(get_entry_depth(data), depth), generation,
+				                            cutoff_shell_count));
+			}
+			return;
+		}
+	}
+
+	// Entries left over from earlier searches are evicted before any entry of the current one.
+	TranspositionEntry *victim = &bucket.entries[0];
+	uint64_t victim_data = victim->data.load(std::memory_order_relaxed);
+	for (int i = 0; i < TRANSPOSITION_TABLE_DEPTH_PREFERRED_SLOTS; ++i) {
+		TranspositionEntry &entry = bucket.entries[i];
+		const uint64_t data = entry.data.load(std::memory_order_relaxed);
+		if (data == 0) {
+			victim = &entry;
+			victim_data = data;
+			break;
+		}
+		const bool entry_is_stale = get_entry_generation(data) != generation;
+		const bool victim_is_stale = get_entry_generation(victim_data) != generation;
+		if ((entry_is_stale && !victim_is_stale) ||
+		    (entry_is_stale == victim_is_stale &&
+		     get_entry_depth(data) < get_entry_depth(victim_data))) {
+			victim = &entry;
+			victim_data = data;
+		}
+	}
+
+	if (victim_data != 0 && get_entry_generation(victim_data) == generation &&
+	    depth < get_entry_depth(victim_data)) {
+		victim = &bucket.entries[TRANSPOSITION_TABLE_BUCKET_SIZE - 1];
+		victim_data = victim->data.load(std::memory_order_relaxed);
 	}
 
-	this->transposition_table[node] = ev;
+	if (victim_data != 0) {
+		count_search_stat(&SearchCounters::tt_evictions);
+	}
+
+	store_entry(*victim, key, pack_entry_data(ev, depth, generation, cutoff_shell_count));
 }
 
-std::optional<float> TranspositionTableManager::get_ev(const Node &node) {
-	auto match = this->transposition_table.find(node);
-	if (match != this->transposition_table.end()) {
-		return match->second;
+std::optional<TranspositionHit> TranspositionTableManager::get_ev(const Node &node,
+                                                                  uint8_t cutoff_shell_count) {
+	count_search_stat(&SearchCounters::tt_probes);
+
+	const uint64_t key = std::hash<Node>{}(node);
+	const uint8_t generation = this->generation.load(std::memory_order_relaxed);
+	TranspositionBucket &bucket = this->get_bucket(key);
+
+	for (TranspositionEntry &entry : bucket.entries) {
+		const uint64_t data = entry.data.load(std::memory_order_relaxed);
+		if ((entry.key_xor_data.load(std::memory_order_relaxed) ^ data) == key) {
+			const uint8_t entry_cutoff_shell_count = get_entry_cutoff_shell_count(data);
+			if (entry_cutoff_shell_count > cutoff_shell_count) {
+				return std::nullopt;
+			}
+			// A hit means the entry is still part of the current game tree, so keep it alive.
+			if (get_entry_generation(data) != generation) {
+				store_entry(entry, key,
+				            pack_entry_data(get_entry_ev(data), get_entry_depth(data), generation,
+				                            entry_cutoff_shell_count));
+			}
+			count_search_stat(&SearchCounters::tt_hits);
+			return TranspositionHit{get_entry_ev(data), entry_cutoff_shell_count};
+		}
 	}
 	return std::nullopt;
 }
 
-void TranspositionTableManager::clear_table(void) { this->transposition_table.clear(); }
+void TranspositionTableManager::clear_table(void) {
+	for (std::size_t i = 0; i < this->bucket_count; ++i) {
+		for (TranspositionEntry &entry : this->buckets[i].entries) {
+			store_entry(entry, 0, 0);
+		}
+	}
+	this->generation.store(0, std::memory_order_relaxed);
+}
+
+void TranspositionTableManager::new_search(void) {
+	this->generation.fetch_add(1, std::memory_order_relaxed);
+}
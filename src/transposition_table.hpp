@@ -1,9 +1,11 @@
 #ifndef TRANSPOSITION_TABLE_HPP
 #define TRANSPOSITION_TABLE_HPP
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <optional>
-#include <unordered_map>
 
 #include "expectimax.hpp"
 
@@ -12,18 +14,58 @@ struct std::hash<Node> {
 	std::size_t operator()(const Node &node) const;
 };
 
-constexpr int TRANSPOSITION_TABLE_MAX_SIZE = 65'535;
+constexpr std::size_t TRANSPOSITION_TABLE_DEFAULT_SIZE_MB = 64;
+constexpr int TRANSPOSITION_TABLE_BUCKET_SIZE = 4;
+// The first DEPTH_PREFERRED_SLOTS entries of a bucket keep the deepest subtrees, the last entry is
+// always replaced.
+constexpr int TRANSPOSITION_TABLE_DEPTH_PREFERRED_SLOTS = TRANSPOSITION_TABLE_BUCKET_SIZE - 1;
+
+// Entries are shared between search threads without locks. The key is stored xor'ed with the data
+// word, so an entry torn by two concurrent writers fails verification and reads as a miss.
+//
+// data layout:
+// 55-48: cutoff shell count (0 for exact EVs, see SearchBudget)
+// 47-40: generation
+// 39-32: depth
+// 31-0: ev (float bits)
+struct TranspositionEntry {
+	std::atomic<uint64_t> key_xor_data{0};  // 0 marks an empty slot
+	std::atomic<uint64_t> data{0};
+};
+
+struct TranspositionHit {
+	float ev;
+	// Positions with this many shells or fewer were estimated instead of searched (0 if exact).
+	uint8_t cutoff_shell_count;
+};
+
+struct alignas(64) TranspositionBucket {
+	TranspositionEntry entries[TRANSPOSITION_TABLE_BUCKET_SIZE];
+};
+
+static_assert(sizeof(TranspositionEntry) == 16);
+static_assert(sizeof(TranspositionBucket) == 64);
 
 class TranspositionTableManager {
    public:
-	TranspositionTableManager() = default;
+	explicit TranspositionTableManager(std::size_t size_mb = TRANSPOSITION_TABLE_DEFAULT_SIZE_MB);
 
-	void add_node(const Node &node, float ev);
-	std::optional<float> get_ev(const Node &node);
-    void clear_table(void);
+	// Only returns EVs searched at least as deep as cutoff_shell_count asks for, so an exact search
+	// never sees an anytime search's estimates.
+	void add_node(const Node &node, float ev, uint8_t cutoff_shell_count = 0);
+	std::optional<TranspositionHit> get_ev(const Node &node, uint8_t cutoff_shell_count = 0);
+	void clear_table(void);
+	void new_search(void);
+	void resize(std::size_t size_mb);
+	std::size_t get_size_mb(void) const;
 
    private:
-	std::unordered_map<Node, float> transposition_table;
+	TranspositionBucket &get_bucket(uint64_t key);
+
+	std::unique_ptr<TranspositionBucket[]> buckets;
+	std::size_t bucket_count = 0;
+	uint64_t index_shift = 64;
+	std::atomic<uint8_t> generation{0};
 };
 
 #endif